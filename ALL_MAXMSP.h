@@ -11,7 +11,11 @@
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
-#include <unistd.h>					
+#include <string.h>
+#include <unistd.h>
+#ifdef WIN_VERSION
+#include <windows.h>
+#endif					
 #include "ext.h"
 #include "z_dsp.h"
 #include "jit.math.h"
@@ -37,10 +37,14 @@
 
 
 #include "ALL_MAXMSP.h"
+#include "db.bounce~_trace.h"
 
 #define sign(a) ( ( (a) < 0 )  ?  -1   : ( (a) > 0 ) )
 
 #define MAX_VOICES 10
+#if MAX_VOICES != TRACE_BUS_VOICES
+	#error "TRACE_BUS_VOICES in db.bounce~_trace.h must match MAX_VOICES"
+#endif
 #define THINNESTPIPE 0.0044		// the smallest distance allowed between bounds
 #define DCBLOCK_GAIN 0.998		// Steepness of DC block filter 
 #define SYMMMIN 0.001
@@ -48,9 +52,34 @@
 #define FMIN 0.001
 #define FMAX 15000.f
 #define MAXFM 40
+#define FM_MAXINTERVAL 256		// slowest control rate for FM ("fmrate"), in samples
+#define SHAPE_MIN 0.1			// shape amounts closer to 0 than this skip the waveshaper
+
+// CPU governor ("governor") - sheds work when perform time nears the vector's duration
+#define GOV_BUDGET 0.25			// default share of the vector duration this object may use
+#define GOV_HYST 0.5			// step back up when load < budget * GOV_HYST...
+#define GOV_HOLD_MS 500			// ...for this long
+#define GOV_SETTLE 32			// vectors to wait after a level change before judging the load again
+#define GOV_SMOOTH 0.1			// one pole smoothing of the measured load
+#define GOV_FMRATE 16			// fm update interval forced at level 2
+#define GOV_SHAPE_MIN 0.2		// shape threshold at level 3 (light shaping off)
+#define GOV_LEVELS 4
+#define KERNEL_PLAIN 2			// index of the plain transition kernel in bounce_kernels[]
+#define KERNEL_LFO 3			// offset of the decimated ("lfo") kernels in bounce_kernels[]
+#define KERNEL_COUNT 6
+#define LFO_MAXDEC 64			// "lfo" - most samples between ensemble steps (power of 2)
+#define LFO_POINTS 64			// fewest steps per bounce of the fastest voice
 #define LKTBL_LNGTH 2048
-
-#define DEBUG_ON 0
+#define FADE_MS 10				// fade time for voices switched on/off by "voices" & "mode"
+#define REC_RING_MS 2000		// "record" buffer between the audio thread and the file (all inlets connected)
+#define REC_MSG_SLOTS 1024		// "record" buffer for messages & floats, power of 2
+#define BUS_MAX 32				// bus names per session ("publish" / "subscribe")
+#define BUS_ALIGN 64			// cache line - buses never share one
+#define BUS_TRIES 8				// reads of a bus caught mid-write before keeping the last copy
+
+#ifndef DEBUG_ON
+#define DEBUG_ON 0				// 1 or 2: post() from the perform path (not real-time safe)
+#endif
 #define POLL_PER_SAMPLES 10000	// debugging - report at this number of sample calculations
 #define POLL_NO_SAMPLES 1028	// debugging - report this number of sample calculations
 
@@ -71,6 +100,31 @@
 #endif
 
 
+// a message / float / dsp change waiting to go into a trace file
+typedef struct _trace_msgslot {
+	uint64_t	seq;		// free for writing at position seq, readable at seq + 1
+	t_trace_rec	rec;
+	char		payload[sizeof(uint64_t) + TRACE_MSGLEN];
+} t_trace_msgslot;
+
+// a named bus between objects ("publish" / "subscribe"): one object writes its ball positions
+// at the end of each vector, any number read them at the start of theirs, on any thread. Two
+// slots: the publisher's vector N (counted from dsp64) goes into slot N & 1, so a subscriber on
+// its vector N reads the publisher's N - 1 while N may be going into the other. No locks - each
+// slot is a seqlock, seq is odd while the positions are being written
+typedef struct _bounce_bus_slot {
+	uint64_t	seq;
+	uint64_t	block;				// publisher's vector count when written
+	uint64_t	count;				// voices published
+	t_double	loc[MAX_VOICES];	// ball positions at the end of that vector
+} t_bounce_bus_slot;
+
+typedef struct _bounce_bus {
+	t_bounce_bus_slot slot[2];
+	uint64_t	last;				// slot written last
+	void		*writer;			// object publishing - claimed and released by its audio thread
+} __attribute__((aligned(BUS_ALIGN))) t_bounce_bus;
+
 typedef struct _bounce {
 	t_pxobject	obj;			
 	t_double  srate;
@@ -87,7 +141,41 @@ typedef struct _bounce {
 	t_double  *ball_loc;	// location of the ball
 	t_int	  *direction;	// current direction of ball (-1/1)
 	t_double	  **fm;			// 2d matrix controling cross modulation between voices
+	t_double	  *fm_sum;		// current modulation sum per voice (interpolated at control rate)
+	t_double	  *fm_step;		// per sample change in fm_sum until the next control rate update
+	t_int	  fm_interval;	// samples between FM updates (1 = every sample)
+	t_int	  fm_interval_run;	// interval in use - fm_interval, or slower if the governor says so
+	t_int	  fm_count;		// samples until next FM update
+	t_bool	  fm_interp;	// lerp between control rate FM updates (otherwise step)
+	t_bool	  lfo_on;		// "lfo" - decimated ensemble, swapped in by the audio thread
+	t_bool	  lfo_run;		// decimated kernels in use
+	t_int	  lfo_dec;		// samples per ensemble step
+	t_int	  lfo_count;	// samples until the next step
+	t_double  lfo_rate;		// highest f0 / width at the last step, sets lfo_dec
+	t_double  lfo_dcgain;	// DC block gain at the step rate
+	t_double  *lfo_val;		// output per voice, ramping to lfo_next
+	t_double  *lfo_step;	// per sample ramp increment
+	t_double  *lfo_next;	// value at the next step (scratch for the voice calcs)
+	t_bounce_bus *bus_pub;		// "publish" - bus the ball positions go to after each vector (claimed)
+	t_bounce_bus *bus_pub_req;	// as set by "publish", claimed by the audio thread
+	uint64_t  bus_pub_asks;		// "publish" messages so far...
+	uint64_t  bus_pub_taken;	// ...and as far as the audio thread has acted on them
+	t_bounce_bus *bus_lost;		// claim lost to another publisher, for bus_qelem to report
+	void	  *bus_qelem;
+	uint64_t  bus_block;		// vectors since dsp64 - a subscriber's N reads a publisher's N - 1
+	t_bounce_bus *bus_sub;		// "subscribe" - bus read before each vector
+	t_bounce_bus *bus_sub_req;
+	t_int	  bus_lo;		// "busbound" - bus voice used as the ensemble's lower bound, -1 none
+	t_int	  bus_hi;
+	t_int	  bus_count;	// voices on the bus at the last read
+	t_int	  bus_new_count;
+	t_double  bus_in[MAX_VOICES];	// bus positions at the last read, where the ramps end
+	t_double  bus_new[MAX_VOICES];	// read for this vector
+	t_double  bus_loc[MAX_VOICES];	// bus positions as the kernels see them, ramping to bus_in
+	t_double  bus_step[MAX_VOICES];	// per sample ramp increment
+	t_double  **busfm;		// [bus voice][voice] cross modulation from the bus ("busfm")
 	t_double	  *shape;
+	t_double  shape_min;	// |shape| below this skips the waveshaper
 	t_double	  **out;		// output pointer
 	t_double  *sin;			// sine wavetable
 	t_double  *sinh;		// hyperbolic sine wavetable
@@ -96,13 +184,58 @@ typedef struct _bounce {
 	t_double	  *dc_prev_in;	// history for dcblock
 	t_double	  *dc_prev_out;
 
+	t_double	  *gain;		// voice fade in/out after "voices" or "mode"
+	t_double	  *gain_target;
+	t_double	  *last_out;	// last output per voice, held while a switched-off voice fades
+	t_double  fade_inc;		// gain step per sample
+
 	t_int	  *hz_conn;		// track inlet signal connection
 	t_int	  *symm_conn;		
 	t_int	  bound_lo_conn;	
 	t_int	  bound_hi_conn;	
 	t_int	  mode;
-
-	t_int	  voice_count;	
+	t_int	  mode_req;		// mode asked for by "mode", swapped in by the audio thread
+
+	t_int	  voice_cap;	// voices allocated (= inlets/outlets), fixed at creation
+	t_int	  voice_count;	// voices running, latched from voice_req by the audio thread
+	t_int	  voice_req;	// voices asked for by "voices"
+
+	t_bool	  gov_on;		// CPU governor
+	t_int	  gov_level;	// 0 full quality ... GOV_LEVELS-1 cheapest
+	t_int	  gov_run;		// level in use - gov_level, once a switch that would click has faded out
+	t_int	  gov_req;		// level asked for by "governor 0" (full quality), -1 none - taken by the audio thread
+	t_double  gov_budget;	// share of vector duration allowed
+	t_double  gov_load;		// smoothed perform time / vector duration
+	t_int	  gov_wait;		// vectors until the load is judged again
+	t_int	  gov_calm;		// vectors spent below the step-up threshold
+	void	  *gov_qelem;	// reports level changes from the main thread
+
+	// input trace ("record"). The audio thread only touches the trace buffers while rec_on
+	// is set, and flags rec_busy while it does, so "record" can stop & free them safely
+	FILE	  *rec_file;		// main thread only
+	t_symbol  *rec_path;
+	t_symbol  *rec_next;		// "record <file>" that came in while the last trace was stopping
+	t_int	  rec_on;
+	t_int	  rec_busy;
+	t_bool	  rec_stopping;		// rec_on cleared, waiting for the audio thread to let go (main thread only)
+	t_bool	  rec_started;		// state snapshot written (first recorded vector)
+	uint64_t  rec_frame;		// frames since recording started, including the vector in progress
+	uint64_t  rec_gap;			// frames dropped since the last block that fitted
+	uint64_t  rec_dropped;		// frames dropped in total
+	char	  *rec_ring;		// audio -> main: trace records, as they go into the file
+	uint64_t  rec_ring_size;
+	uint64_t  rec_head;			// bytes published by the audio thread
+	uint64_t  rec_tail;			// bytes written out by the main thread
+	uint64_t  rec_wpos;			// audio thread's write position (published at the end of the vector)
+	uint64_t  rec_block_at;		// ring position of this vector's block, written after the kernel
+	t_trace_block rec_blk;		// this vector's block header
+	t_bool	  rec_block_ok;		// this vector's block fitted in the ring
+	t_trace_msgslot *rec_msgs;	// messages -> main, from any thread (allocated on first use, kept)
+	uint64_t  rec_msg_head;
+	uint64_t  rec_msg_tail;
+	uint64_t  rec_msg_lost;		// messages dropped with the queue full
+	t_double  *rec_state;		// snapshot scratch, TRACE_STATE_VALUES(voice_cap) - while recording
+	void	  *rec_qelem;		// writes the buffers out on the main thread, finishes a stop
 	t_int	  curr_v;
 #if DEBUG_ON == 1 || DEBUG_ON == 2
 	t_int poll_count;	// DEBUG
@@ -110,9 +243,35 @@ typedef struct _bounce {
 	t_int debug_count;	// DEBUG
 #endif
 	t_bool fm_on; // controls whether cross modulation is on or off (saves computation)
+	t_bool fm_run;	// fm_on as the kernels see it, latched by the audio thread
 }	t_bounce;
 
 static t_class *bounce_class;	// pointer to the class of this object
+static t_symbol *bounce_bus_names[BUS_MAX];		// claimed on first use, never released
+static t_bounce_bus bounce_buses[BUS_MAX];
+
+
+/************************************************************
+!!!!!!!!!!!!	AUDIO KERNELS		!!!!!!!!!!!!
+*************************************************************/
+
+// The hot per-sample code lives in db.bounce~_kernels.h. It is scalar - each voice is bounded by
+// the one before it in the same sample - and builds of it for AVX2+FMA and AVX-512 measured no
+// faster than plain x86-64 (AVX-512 up to 40% slower with dense fm), so there is one build of it,
+// for whatever the compiler flags target
+typedef void (*t_bounce_kernel)(t_bounce *x, double **ins, double **outs, long sampleframes);
+typedef void (*t_bounce_voicecalc)(t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t);
+
+#include "db.bounce~_kernels.h"
+
+// [mode, or KERNEL_PLAIN, + KERNEL_LFO for "lfo"]
+static t_bounce_kernel bounce_kernels[KERNEL_COUNT] = { bounce_perform_shaper, bounce_perform_ptr, bounce_perform_plain,
+	bounce_perform_lfo_shaper, bounce_perform_lfo_ptr, bounce_perform_lfo_plain };
+
+static const char *bounce_gov_names[GOV_LEVELS] = { "full quality", "ptr off", "control rate fm", "light shaping off" };
+#ifdef WIN_VERSION
+static double bounce_clock_scale;	// ns per performance counter tick
+#endif
 
 // MSP infrastructure functions
 void	*bounce_new(t_symbol *s, short argc, t_atom *argv);
@@ -127,21 +286,60 @@ void	bounce_dcblock_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
 void	bounce_fm_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
 void	bounce_shape_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
 void	bounce_fmax_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_voices_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_mode_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_fmrate_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_fminterp_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_governor_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_lfo_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_publish_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_subscribe_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_busbound_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_busfm_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_record_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
 
 
 // Audio Calc functions
 void 	bounce_PerformWrapper(t_bounce *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
-void 	bounce_perform64(t_bounce *x, double **ins, double **outs, long sampleframes, void (*voicemode)(t_bounce *, t_double, t_double, t_double, t_double));
-void	 bounce_ptr_voicecalc (t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t);
-void 	bounce_shaper_voicecalc (t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t);
-
-t_double  bounce_dcblock(t_double input, t_double *lastinput, t_double *lastoutput, t_double gain);
-t_double bounce_fmcalc (t_bounce *x, t_int curr_voice);
-t_double ptr_correctmax(t_double p, t_double a, t_double b, t_double t, t_double pmin, t_double pmax);
-t_double ptr_correctmin(t_double p, t_double a, t_double b, t_double t, t_double pmin, t_double pmax);
 void	 setup_lktables (t_bounce* x, t_int shape);
-double	 do_shaping (t_bounce *x, t_double lo, t_double hi) ;
-double	 bounce_alimit(double a, double width, double t);
+void	 bounce_voice_init (t_bounce *x, t_int v);
+void	 bounce_reconfigure (t_bounce *x);
+void	 bounce_governor (t_bounce *x, double elapsed_ns, long sampleframes);
+t_bool	 bounce_governor_useful (t_bounce *x, t_int level);
+t_bool	 bounce_governor_clicks (t_bounce *x);
+void	 bounce_governor_report (t_bounce *x);
+void	 bounce_fm_check (t_bounce *x);
+double	 bounce_clock_ns (void);
+
+// input trace recording ("record", db.bounce~_trace.h)
+void	bounce_record_do(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_trace_start(t_bounce *x, t_symbol *path);
+void	bounce_trace_stop(t_bounce *x);
+void	bounce_trace_finish(t_bounce *x);
+void	bounce_trace_drain(t_bounce *x);
+void	bounce_trace_flush(t_bounce *x);
+void	bounce_trace_push(t_bounce *x, uint32_t type, const void *payload, uint32_t size);
+t_bool	bounce_trace_pop(t_bounce *x, t_trace_msgslot *out);
+void	bounce_trace_msg(t_bounce *x, t_symbol *msg, short argc, t_atom *argv);
+void	bounce_trace_float(t_bounce *x, long inlet, double f);
+void	bounce_trace_dsp(t_bounce *x, short *count, double samplerate, long maxvectorsize);
+void	bounce_trace_state(t_bounce *x, t_double *s, t_bool save);
+void	bounce_trace_write(t_bounce *x, uint64_t pos, const void *src, uint64_t n);
+void	bounce_trace_append(t_bounce *x, const void *src, uint64_t n);
+t_bool	bounce_trace_begin(t_bounce *x, double **ins, long sampleframes);
+void	bounce_trace_end(t_bounce *x, double **outs, long sampleframes, double elapsed_ns);
+
+// buses between objects ("publish", "subscribe")
+t_bounce_bus *bounce_bus_find(t_symbol *name);
+void	bounce_bus_claim(t_bounce *x);
+void	bounce_bus_release(t_bounce *x);
+void	bounce_bus_report(t_bounce *x);
+void	bounce_bus_write(t_bounce_bus *bus, uint64_t block, const t_double *loc, t_int count);
+t_bool	bounce_bus_copy(t_bounce *x, t_bounce_bus_slot *slot, uint64_t *block);
+void	bounce_bus_read(t_bounce *x);
+void	bounce_bus_ramp(t_bounce *x, long sampleframes);
+
+// instruction set dispatch for the audio kernels
 
 // my infrastructure functions
 double infr_scale_param(double in, double in_min, double in_max, double out_min, double out_max);
@@ -170,17 +368,37 @@ int C74_EXPORT main (void)
 	class_addmethod(bounce_class, (method)bounce_fm_onoff, "fmoff", A_GIMME, 0);
 	class_addmethod(bounce_class, (method)bounce_shape_set, "shape", A_GIMME, 0);
 	class_addmethod(bounce_class, (method)bounce_fmax_set, "fmax", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_voices_set, "voices", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_mode_set, "mode", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_fmrate_set, "fmrate", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_fminterp_set, "fminterp", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_governor_set, "governor", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_lfo_set, "lfo", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_publish_set, "publish", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_subscribe_set, "subscribe", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_busbound_set, "busbound", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_busfm_set, "busfm", A_GIMME, 0);
+	class_addmethod(bounce_class, (method)bounce_record_set, "record", A_GIMME, 0);
 	
 
 	class_dspinit(bounce_class);
 	class_register(CLASS_BOX, bounce_class);
 
+#ifdef WIN_VERSION
+	{
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		bounce_clock_scale = 1e9 / (double) freq.QuadPart;
+	}
+#endif
+
 	post("db.bounce~ by Daniel Bennett skjolbrot@gmail.com");
 	post("- Peter Blasser inspired Triangle \"Bounce & Bounds\" oscillators");
 	post("args:- 1) no of voices (default 1 - henceforth \"n\") ");
 	post("args:- 2) Lower bound for voice 1 (default -1)");
 	post("args:- 3) Upper bound for voice n (default 1) ");
 	post("args:- 4) mode - 0: waveshaping 1: antialiased triangle (via ptr) ");
+	post("args:- 5) voices running at start (default n, change with \"voices\")");
 
 	// report to the MAX window
 	return 0;
@@ -191,27 +409,51 @@ void bounce_dsp_free (t_bounce *x)
 	int i;
 
 	dsp_free((t_pxobject *)x);
+	bounce_bus_release(x);		// dsp_free() has taken us out of the chain - no more writes
+	qelem_free(x->bus_qelem);
+	qelem_free(x->gov_qelem);
+	if(x->rec_file){	// dsp_free() has taken us out of the chain - perform can't be holding the buffers
+		x->rec_next = NULL;
+		__atomic_store_n(&x->rec_on, 0, __ATOMIC_SEQ_CST);
+		bounce_trace_finish(x);
+	}
+	qelem_free(x->rec_qelem);
+	if(x->rec_msgs){
+		t_freebytes(x->rec_msgs, REC_MSG_SLOTS * sizeof(t_trace_msgslot));
+	}
 
-	t_freebytes(x->hz, x->voice_count * sizeof(t_double *));
-	t_freebytes(x->out, x->voice_count * sizeof(t_double *));
-	t_freebytes(x->symm, x->voice_count * sizeof(t_double *));
-	t_freebytes(x->hzFloat, x->voice_count * sizeof(t_double ));
-	t_freebytes(x->grad, x->voice_count * sizeof(t_double ));
-	t_freebytes(x->ball_loc, x->voice_count * sizeof(t_double ));
-	t_freebytes(x->shape, x->voice_count * sizeof(t_double ));
-	t_freebytes(x->direction, x->voice_count * sizeof(t_int ));
-	t_freebytes(x->hz_conn, x->voice_count * sizeof(t_int ));
-	t_freebytes(x->symm_conn, x->voice_count * sizeof(t_int ));
-	t_freebytes(x->dcblock_on, x->voice_count * sizeof(t_int ));
-	t_freebytes(x->dc_prev_in, x->voice_count * sizeof(t_double ));
-	t_freebytes(x->dc_prev_out, x->voice_count * sizeof(t_double ));
+	t_freebytes(x->hz, x->voice_cap * sizeof(t_double *));
+	t_freebytes(x->out, x->voice_cap * sizeof(t_double *));
+	t_freebytes(x->symm, x->voice_cap * sizeof(t_double *));
+	t_freebytes(x->hzFloat, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->grad, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->ball_loc, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->shape, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->direction, x->voice_cap * sizeof(t_int ));
+	t_freebytes(x->hz_conn, x->voice_cap * sizeof(t_int ));
+	t_freebytes(x->symm_conn, x->voice_cap * sizeof(t_int ));
+	t_freebytes(x->dcblock_on, x->voice_cap * sizeof(t_int ));
+	t_freebytes(x->dc_prev_in, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->dc_prev_out, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->gain, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->gain_target, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->last_out, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->fm_sum, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->fm_step, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->lfo_val, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->lfo_step, x->voice_cap * sizeof(t_double ));
+	t_freebytes(x->lfo_next, x->voice_cap * sizeof(t_double ));
 	t_freebytes(x->sin, LKTBL_LNGTH * sizeof(t_double ));
 	t_freebytes(x->sinh, LKTBL_LNGTH * sizeof(t_double ));
 
-	for (i =0; i < x->voice_count; i++){
-			t_freebytes(x->fm[i], x->voice_count * sizeof(t_double));
+	for (i =0; i < x->voice_cap; i++){
+			t_freebytes(x->fm[i], x->voice_cap * sizeof(t_double));
 		}
-	t_freebytes(x->fm, x->voice_count * sizeof(t_double *));
+	t_freebytes(x->fm, x->voice_cap * sizeof(t_double *));
+	for (i =0; i < MAX_VOICES; i++){
+			t_freebytes(x->busfm[i], x->voice_cap * sizeof(t_double));
+		}
+	t_freebytes(x->busfm, MAX_VOICES * sizeof(t_double *));
 
 
 }
@@ -221,72 +463,122 @@ void bounce_dsp_free (t_bounce *x)
 void *bounce_new(t_symbol *s, short argc, t_atom *argv)
 {
 	t_double bound_lo = -1.0, bound_hi = 1.0;
-	t_int i = 0, j = 0, dir = -1;
+	t_int i = 0, j = 0;
 	t_bounce *x = object_alloc(bounce_class); // set aside memory for the struct for the object
 
 	x->mode = 0;
 	x->fmax = FMAX * 0.5;
 	x->bound_lo = bound_lo; 
 	x->bound_hi = bound_hi;
-	atom_arg_getlong(&(x->voice_count), 0, argc, argv);
+	atom_arg_getlong(&(x->voice_cap), 0, argc, argv);
 	atom_arg_getdouble(&(x->bound_lo), 1, argc, argv);
 	atom_arg_getdouble(&(x->bound_hi), 2, argc, argv);
 	x->mode = atom_getintarg(3,argc,argv); 
 	if(x->mode < 0) x->mode = 0;
 	else if (x->mode > 1) x->mode = 1;
+	x->mode_req = x->mode;
+	x->voice_count = 0;
+	atom_arg_getlong(&(x->voice_count), 4, argc, argv);
 
 	//protect against invalid parameters
-	if(x->voice_count > MAX_VOICES) {
-		x->voice_count = MAX_VOICES; 
-	} else if (x->voice_count < 1) {
-		x->voice_count = 1; 
+	if(x->voice_cap > MAX_VOICES) {
+		x->voice_cap = MAX_VOICES; 
+	} else if (x->voice_cap < 1) {
+		x->voice_cap = 1; 
+	}
+	if(x->voice_count > x->voice_cap || x->voice_count < 1){
+		x->voice_count = x->voice_cap;
 	}
+	x->voice_req = x->voice_count;
 	// add to dsp chain, set up inlets 
-	dsp_setup((t_pxobject *)x, 2*x->voice_count + 2); // upper and lower bounds, plus hz and symm per voice
+	dsp_setup((t_pxobject *)x, 2*x->voice_cap + 2); // upper and lower bounds, plus hz and symm per voice
 	x->obj.z_misc |= Z_NO_INPLACE; // force independent signal vectors
 
 	// allocate memory for variable arrays
-	x->hz = (t_double **) t_getbytes(x->voice_count * sizeof(t_double *));
-	x->symm = (t_double **) t_getbytes(x->voice_count * sizeof(t_double *));
-	x->out = (t_double **) t_getbytes(x->voice_count * sizeof(t_double *));
-	x->hzFloat = (t_double *) t_getbytes(x->voice_count * sizeof(t_double));
-	x->grad = (t_double *) t_getbytes(x->voice_count * sizeof(t_double));
-	x->ball_loc = (t_double *) t_getbytes(x->voice_count * sizeof(t_double));
-	x->direction = (t_int *) t_getbytes(x->voice_count * sizeof(t_int));
-	x->hz_conn = (t_int *) t_getbytes(x->voice_count * sizeof(t_int));
-	x->symm_conn = (t_int *) t_getbytes(x->voice_count * sizeof(t_int));
-	x->dcblock_on = (t_bool *) t_getbytes(x->voice_count * sizeof(t_bool));
-	x->dc_prev_in = (t_double *) t_getbytes(x->voice_count * sizeof(t_double));
-	x->dc_prev_out = (t_double *) t_getbytes(x->voice_count * sizeof(t_double));
-	x->fm = (t_double **) t_getbytes(x->voice_count * sizeof(t_double *));
-	x->shape = (t_double *) t_getbytes(x->voice_count * sizeof(t_double));
+	x->hz = (t_double **) t_getbytes(x->voice_cap * sizeof(t_double *));
+	x->symm = (t_double **) t_getbytes(x->voice_cap * sizeof(t_double *));
+	x->out = (t_double **) t_getbytes(x->voice_cap * sizeof(t_double *));
+	x->hzFloat = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->grad = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->ball_loc = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->direction = (t_int *) t_getbytes(x->voice_cap * sizeof(t_int));
+	x->hz_conn = (t_int *) t_getbytes(x->voice_cap * sizeof(t_int));
+	x->symm_conn = (t_int *) t_getbytes(x->voice_cap * sizeof(t_int));
+	x->dcblock_on = (t_bool *) t_getbytes(x->voice_cap * sizeof(t_bool));
+	x->dc_prev_in = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->dc_prev_out = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->fm = (t_double **) t_getbytes(x->voice_cap * sizeof(t_double *));
+	x->busfm = (t_double **) t_getbytes(MAX_VOICES * sizeof(t_double *));
+	x->shape = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->gain = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->gain_target = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->last_out = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->fm_sum = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->fm_step = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->lfo_val = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->lfo_step = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+	x->lfo_next = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
 	x->sin = (t_double *)  t_getbytes(LKTBL_LNGTH * sizeof(t_double)); 
 	x->sinh = (t_double *)  t_getbytes(LKTBL_LNGTH * sizeof(t_double)); 
 
 	setup_lktables(x,0); // build lookup tables for waveshaper
 
 	//set up outlets & and get rate for each voice from args
-	x->ball_loc[0] = bound_lo + THINNESTPIPE; 
-	x->direction[0] = 1;
-	for(i=0; i < x->voice_count; i++){
-		x->fm[i] = (t_double *) t_getbytes(x->voice_count * sizeof(t_double));
+	for(i=0; i < x->voice_cap; i++){
+		x->fm[i] = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
 		outlet_new((t_object *)x, "signal"); 
 
 		x->shape[i] = 0.1f;
 		x->grad[i] = 2;
 		x->hzFloat[i] = 100;
-		x->ball_loc[i] =  (x->ball_loc[i-1] + THINNESTPIPE); // begin near bottom of current bound
-		dir *= -1,  x->direction[i] = dir;	// alternate up and down 
+		bounce_voice_init(x, i);
 		x->dcblock_on[i] = 0;
-		x->dc_prev_in[i] = x->dc_prev_out[i] = 0.f;
-		for(j =0; j< x->voice_count; j++){
+		x->gain[i] = x->gain_target[i] = i < x->voice_count ? 1 : 0;
+		x->last_out[i] = 0;
+		for(j =0; j< x->voice_cap; j++){
 			x->fm[i][j] = 0.0;
 		}
 	}
+	for(i=0; i < MAX_VOICES; i++){
+		x->busfm[i] = (t_double *) t_getbytes(x->voice_cap * sizeof(t_double));
+		x->bus_in[i] = x->bus_new[i] = x->bus_loc[i] = x->bus_step[i] = 0;
+		for(j =0; j< x->voice_cap; j++){
+			x->busfm[i][j] = 0.0;
+		}
+	}
 
 	// initialize remaining parameters
 	x->srate = (t_double)sys_getsr();
-	x->fm_on = 0;
+	x->fade_inc = 1000. / (FADE_MS * x->srate);
+	x->fm_on = x->fm_run = 0;
+	x->fm_interval = x->fm_interval_run = 1;
+	x->fm_count = 0;
+	x->fm_interp = 1;
+	x->lfo_on = x->lfo_run = 0;
+	x->lfo_dec = 1, x->lfo_count = 0;
+	x->lfo_rate = 0;
+	x->lfo_dcgain = DCBLOCK_GAIN;
+	x->bus_pub = x->bus_pub_req = x->bus_lost = x->bus_sub = x->bus_sub_req = NULL;
+	x->bus_pub_asks = x->bus_pub_taken = 0;
+	x->bus_qelem = qelem_new(x, (method)bounce_bus_report);
+	x->bus_block = 0;
+	x->bus_lo = x->bus_hi = -1;
+	x->bus_count = x->bus_new_count = 0;
+	x->shape_min = SHAPE_MIN;
+	x->gov_on = 0;
+	x->gov_level = x->gov_run = 0;
+	x->gov_req = -1;
+	x->gov_budget = GOV_BUDGET;
+	x->gov_load = 0;
+	x->gov_wait = x->gov_calm = 0;
+	x->gov_qelem = qelem_new(x, (method)bounce_governor_report);
+	x->rec_file = NULL;
+	x->rec_next = NULL;
+	x->rec_on = x->rec_busy = x->rec_stopping = 0;
+	x->rec_ring = NULL;
+	x->rec_msgs = NULL;
+	x->rec_state = NULL;
+	x->rec_qelem = qelem_new(x, (method)bounce_trace_flush);
 
 #if DEBUG_ON == 1|| DEBUG_ON == 2
 	x->poll_count = POLL_NO_SAMPLES-1;
@@ -308,6 +600,8 @@ void	bounce_dsp64(t_bounce *x, t_object *dsp64, short *count, double samplerate,
 	if(x->srate != samplerate){
 		x->srate = samplerate;
 	}
+	x->fade_inc = 1000. / (FADE_MS * x->srate);
+	x->bus_block = 0;		// every object in the chain restarts its count together
 
 
 	object_method(dsp64, gensym("dsp_add64"), x, bounce_PerformWrapper, 0, NULL);
@@ -315,11 +609,11 @@ void	bounce_dsp64(t_bounce *x, t_object *dsp64, short *count, double samplerate,
 	// check if signals are connected
 	x->bound_lo_conn = count[0];
 	x->bound_hi_conn = count[1];
-	for(i=0; i< x->voice_count; i++){
+	for(i=0; i< x->voice_cap; i++){
 		x->hz_conn[i] = count[i+2];
-		x->symm_conn[i] = count[i + 2 + x->voice_count];
+		x->symm_conn[i] = count[i + 2 + x->voice_cap];
 	}
-
+	bounce_trace_dsp(x, count, samplerate, maxvectorsize);
 
 }
 
@@ -331,10 +625,10 @@ void bounce_assist(t_bounce *x, void *b, long msg, long arg, char *dst)
 		case 0: sprintf(dst,"(signal/float) Lower Bound"); break;
 		case 1: sprintf(dst,"(signal/float) Upper Bound"); break;
 		default:
-			if(arg > 1 && arg < x->voice_count + 2 ){
+			if(arg > 1 && arg < x->voice_cap + 2 ){
 				sprintf(dst,"(signal/float) freq %ld", arg - 1);
 			} else {
-				sprintf(dst,"(signal/float) symmetry %d, (0-1)", (int)(arg - x->voice_count -1));
+				sprintf(dst,"(signal/float) symmetry %d, (0-1)", (int)(arg - x->voice_cap -1));
 			}				
 			break;
 		}
@@ -354,21 +648,22 @@ void bounce_float(t_bounce *x, double f)
 	double symm;
 	int inlet = ((t_pxobject*)x)->z_in;
 
+	bounce_trace_float(x, inlet, f);
 
 	switch(inlet){
 		case 0: x->bound_lo = (t_double) f; break;
 		case 1: x->bound_hi = (t_double) f; break;
 		default: 
-			if (inlet < x->voice_count + 2 && inlet > 0) {
+			if (inlet < x->voice_cap + 2 && inlet > 0) {
 				x->hzFloat[inlet - 2] = (t_double) fabs(f);
-			} else if (inlet -2 < x->voice_count * 2 && inlet > 0) {
+			} else if (inlet -2 < x->voice_cap * 2 && inlet > 0) {
 
 				if(f < SYMMMIN) symm = SYMMMIN;
 				else if (f > SYMMMAX) symm = SYMMMAX;
 				else symm = f;
 				
 				grad  = 1/symm;
-				x->grad[inlet - (2 + x->voice_count)] = grad;
+				x->grad[inlet - (2 + x->voice_cap)] = grad;
 
 			}
 			break;
@@ -390,8 +685,10 @@ void	bounce_dcblock_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
 {
 	int i;
 
+	bounce_trace_msg(x, msg, argc, argv);
+
 	if(argc >= 1){
-		for(i =0; i < argc && i < x->voice_count; i++){
+		for(i =0; i < argc && i < x->voice_cap; i++){
 			x->dcblock_on[i] = (t_bool) atom_getintarg(i,argc,argv);
 		}
 	}
@@ -403,10 +700,12 @@ void bounce_shape_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
 	t_int v;
 	t_double amt = 0;
 
+	bounce_trace_msg(x, msg, argc, argv);
+
 	v =  atom_getintarg(0,argc, argv);
 	atom_arg_getdouble(&amt, 1, argc, argv);
 	v-= 1;
-	if(v < x->voice_count && v >= 0 ){
+	if(v < x->voice_cap && v >= 0 ){
 		if(amt < 0){
 			if (amt > -0.05f) amt = -0.05f;
 			else if (amt < -1.f) amt = -1.f;
@@ -423,25 +722,204 @@ void bounce_shape_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
 void bounce_fmax_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
 {
 	t_double f;
+
+	bounce_trace_msg(x, msg, argc, argv);
 	atom_arg_getdouble(&f, 0, argc, argv);
 	if(f<=FMAX && f>=FMIN){
 		x->fmax = f * 0.5;
 	}
 }
 
+// MSG "voices" symbol input + int sets number of voices running (1 ... voices given at creation)
+// the ensemble fades out, changes and fades back in
+void bounce_voices_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_atom_long n = x->voice_req;
+
+	bounce_trace_msg(x, msg, argc, argv);
+	atom_arg_getlong(&n, 0, argc, argv);
+	if(n < 1) n = 1;
+	else if(n > x->voice_cap) n = x->voice_cap;
+	x->voice_req = n;
+}
+
+// MSG "mode" symbol input + int, 0: waveshaping 1: antialiased triangle (via ptr)
+// the ensemble fades out, swaps kernel and fades back in
+void bounce_mode_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_atom_long m = x->mode_req;
+
+	bounce_trace_msg(x, msg, argc, argv);
+	atom_arg_getlong(&m, 0, argc, argv);
+	if(m < 0) m = 0;
+	else if(m > 1) m = 1;
+	x->mode_req = m;
+}
+
+// MSG "fmrate" symbol input + int sets how often (in samples) cross modulation is recalculated
+// 1 = every sample, higher values save CPU on dense fm matrices (up to FM_MAXINTERVAL)
+void bounce_fmrate_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_atom_long n = 1;
+
+	bounce_trace_msg(x, msg, argc, argv);
+	atom_arg_getlong(&n, 0, argc, argv);
+	if(n < 1) n = 1;
+	else if(n > FM_MAXINTERVAL) n = FM_MAXINTERVAL;
+	x->fm_interval = n;
+}
+
+// MSG "fminterp" symbol input + int (0/1) - interpolate between control rate FM updates or step
+void bounce_fminterp_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	bounce_trace_msg(x, msg, argc, argv);
+	x->fm_interp = (t_bool) (atom_getintarg(0,argc,argv) != 0);
+}
+
+// MSG "lfo" symbol input + int (0/1) - for slow modulation: the ensemble (movement, bounds, fm)
+// steps every 1-LFO_MAXDEC samples depending on the fastest voice, and outputs are interpolated
+void bounce_lfo_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	bounce_trace_msg(x, msg, argc, argv);
+	x->lfo_on = (t_bool) (atom_getintarg(0,argc,argv) != 0);
+}
+
+// MSG "publish" symbol input + bus name - the ensemble's ball positions go onto the bus at the end
+// of every vector, for other objects to "subscribe" to. One publisher per bus. "publish" alone stops
+void bounce_publish_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_bounce_bus *bus = NULL;
+	void *writer;
+
+	bounce_trace_msg(x, msg, argc, argv);
+	if(argc >= 1 && atom_gettype(argv) == A_SYM){
+		bus = bounce_bus_find(atom_getsym(argv));
+		if(!bus){
+			post("ERROR - db.bounce~ has no room for bus %s (%d names at most)", atom_getsym(argv)->s_name, BUS_MAX);
+			return;
+		}
+		writer = __atomic_load_n(&bus->writer, __ATOMIC_ACQUIRE);
+		if(writer && writer != (void *) x){
+			post("ERROR - bus %s already has a publisher", atom_getsym(argv)->s_name);
+			return;
+		}
+	}
+	__atomic_store_n(&x->bus_pub_req, bus, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&x->bus_pub_asks, 1, __ATOMIC_RELEASE);	// claimed by the next perform call
+}
+
+// MSG "subscribe" symbol input + bus name - read a bus's positions (for "busbound" & "busfm") at the
+// start of every vector. They ramp across the vector to where the publisher's vector before this
+// one ended: one vector late, whichever runs first in the dsp chain. A publisher out of step (not
+// in the same chain, or on another thread in the Linux host) is read at its last finished vector.
+// "subscribe" alone stops
+void bounce_subscribe_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_bounce_bus *bus = NULL;
+
+	bounce_trace_msg(x, msg, argc, argv);
+	if(argc >= 1 && atom_gettype(argv) == A_SYM){
+		bus = bounce_bus_find(atom_getsym(argv));
+		if(!bus){
+			post("ERROR - db.bounce~ has no room for bus %s (%d names at most)", atom_getsym(argv)->s_name, BUS_MAX);
+			return;
+		}
+	}
+	__atomic_store_n(&x->bus_sub_req, bus, __ATOMIC_RELEASE);
+}
+
+// MSG "busbound" symbol input + lo/hi + int - take the ensemble's lower or upper bound from a voice
+// on the subscribed bus (1 ... voices published) in place of the inlet. 0 goes back to the inlet
+void bounce_busbound_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_atom_long v = 0;
+
+	bounce_trace_msg(x, msg, argc, argv);
+	if(argc < 1 || atom_gettype(argv) != A_SYM){
+		post("ERROR - busbound needs lo or hi and a bus voice");
+		return;
+	}
+	atom_arg_getlong(&v, 1, argc, argv);
+	if(v < 0 || v > MAX_VOICES) v = 0;
+	if(!strcmp(atom_getsym(argv)->s_name, "lo")){
+		x->bus_lo = v - 1;
+	} else if(!strcmp(atom_getsym(argv)->s_name, "hi")){
+		x->bus_hi = v - 1;
+	} else {
+		post("ERROR - busbound needs lo or hi and a bus voice");
+	}
+}
+
+// MSG "busfm" symbol input, as "fm" with the modulator a voice on the subscribed bus (from, to, amt)
+void bounce_busfm_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_int in, out;
+	t_double val = 0;
+
+	bounce_trace_msg(x, msg, argc, argv);
+	if(argc == 3){
+		in = atom_getintarg(0,argc, argv);
+		out = atom_getintarg(1,argc, argv);
+		atom_arg_getdouble(&val, 2, argc, argv);
+		in -= 1, out -= 1;
+
+		if(in < 0 || in >= MAX_VOICES || out < 0 || out >= x->voice_cap){
+			post("ERROR - invalid bus cross mod argument");
+			return;
+		}
+		x->busfm[in][out] = val < MAXFM ? val: MAXFM;
+		if(val == 0.){
+			bounce_fm_check(x);
+		} else {
+			x->fm_on = 1;
+		}
+	}
+}
+
+// MSG "governor" symbol input + int (0/1) + optional float budget (share of the vector duration
+// this object may use, default GOV_BUDGET). No arguments reports the current level
+void bounce_governor_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	t_double budget = x->gov_budget;
+
+	if(argc >= 1){
+		x->gov_on = (t_bool) (atom_getintarg(0,argc,argv) != 0);
+		atom_arg_getdouble(&budget, 1, argc, argv);
+		if(budget > 0.01 && budget <= 1){
+			x->gov_budget = budget;
+		} else {
+			post("ERROR - governor budget must be over 0.01 and at most 1 (share of the vector duration), keeping %.2f", x->gov_budget);
+		}
+		if(!x->gov_on){
+			__atomic_store_n(&x->gov_req, 0, __ATOMIC_RELEASE);	// full quality, fading if it would click
+		}
+	}
+	bounce_governor_report(x);
+}
+
+// MSG "record" symbol input + file path starts writing an input trace (inlet signals, floats,
+// messages, starting state) for host/bounce_replay. "record" alone stops it. File work is
+// deferred to the main thread
+void bounce_record_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	defer_low(x, (method)bounce_record_do, msg, argc, argv);
+}
+
 
 // MSG "fm" symbol input, controls modulation amounts via list of 2 ints and a float (from, to, amt)
 void	bounce_fm_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
 {
 	t_int in, out;
 	t_double val = 0;
+
+	bounce_trace_msg(x, msg, argc, argv);
 	if(argc == 3){
 			in =  atom_getintarg(0,argc, argv);
 			out = atom_getintarg(1,argc, argv);
 			atom_arg_getdouble(&val, 2, argc, argv);
 			in -= 1, out -=1;
 
-			if(in <0 || in >= x->voice_count || out <0 || out >= x->voice_count){
+			if(in <0 || in >= x->voice_cap || out <0 || out >= x->voice_cap){
 				post("ERROR - invalid cross mod argument");
 				in = 0, out = 0, val = 0;
 			} else {
@@ -450,32 +928,29 @@ void	bounce_fm_set(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
 			
 			if(val == 0.){
 				// check if any other modulation is on, and set fm_on flag accordingly
-				for(in = 0; in < x->voice_count; in++){
-					for(out = 0; out < x->voice_count; out++){
-						if(fabs(x->fm[in][out]) > 0.0001){
-							x->fm_on = 1;
-							goto quit_check_loop;
-						}
-					}
-					x->fm_on = 0; // only reached if no modulation is on
-				}
+				bounce_fm_check(x);
 			}else{
 				x->fm_on = 1;
 			}
 	}
-quit_check_loop:
-	;
 }
 
 // MSG "fmoff" symbol input, turns off modulation
 void	bounce_fm_onoff(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
 {
 	int in, out;
-	for(in = 0; in < x->voice_count; in++){
-		for(out = 0; out < x->voice_count; out++){
+
+	bounce_trace_msg(x, msg, argc, argv);
+	for(in = 0; in < x->voice_cap; in++){
+		for(out = 0; out < x->voice_cap; out++){
 				x->fm[in][out] = 0;
 		}
 	}	
+	for(in = 0; in < MAX_VOICES; in++){
+		for(out = 0; out < x->voice_cap; out++){
+				x->busfm[in][out] = 0;
+		}
+	}
 	x->fm_on = 0;
 }
 
@@ -497,347 +972,860 @@ double infr_scale_param(double in, double in_min, double in_max, double out_min,
 
 }
 
+// set fm_on if any cross modulation is on, within the ensemble or from a bus
+void bounce_fm_check(t_bounce *x)
+{
+	t_int in, out;
+
+	for(out = 0; out < x->voice_cap; out++){
+		for(in = 0; in < x->voice_cap; in++){
+			if(fabs(x->fm[in][out]) > 0.0001){
+				x->fm_on = 1;
+				return;
+			}
+		}
+		for(in = 0; in < MAX_VOICES; in++){
+			if(fabs(x->busfm[in][out]) > 0.0001){
+				x->fm_on = 1;
+				return;
+			}
+		}
+	}
+	x->fm_on = 0;
+}
+
+
+
 
 /************************************************************
-!!!!!!!!!!!!	AUDIO CALC FUNCTIONS		!!!!!!!!!!!!
+!!!!!!!!!!!!	BUSES BETWEEN OBJECTS		!!!!!!!!!!!!
 *************************************************************/
 
-t_double bounce_dcblock(t_double input, t_double *lastinput, t_double *lastoutput, t_double gain)
-{	
-	t_double output;
-	output = input - *lastinput + gain * *lastoutput;
-	*lastinput  = input;
-	*lastoutput = output;
-	return output;
-}
-
-t_double bounce_fmcalc (t_bounce *x, t_int curr_voice)
-{	
-	t_double  modsum, modhz;
+// message handlers: the bus with this name, claiming a free one the first time. NULL if all
+// BUS_MAX are taken. Buses are static and never released, so the audio threads can't lose one
+t_bounce_bus *bounce_bus_find(t_symbol *name)
+{
+	t_symbol *n;
 	t_int i;
-	if(x->fm_on){
-		//get sum of modulations
-		modsum = 1;
-		for(i =0; i <x->voice_count; i++){
-			if(x->fm[i][curr_voice] != 0){	//i!=curr_voice && 
-				modsum += x->ball_loc[i] * x->fm[i][curr_voice];
-			}
+
+	for(i = 0; i < BUS_MAX; i++){
+		n = __atomic_load_n(&bounce_bus_names[i], __ATOMIC_ACQUIRE);
+		if(!n && __atomic_compare_exchange_n(&bounce_bus_names[i], &n, name, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+			return &bounce_buses[i];
+		}
+		if(n == name){	// symbols are unique, so the pointer is the name
+			return &bounce_buses[i];
 		}
-		// apply modulation to freq of this voice
-		modhz = fabs(*(x->hz[curr_voice]) * modsum);
-		modhz = modhz < 0 ? 0 : modhz;
-		return modhz;
-	} else {
-		return *x->hz[curr_voice];
 	}
+	return NULL;
 }
 
-// Correction functions for Polynomial Transition Region algorithm
-t_double ptr_correctmax(t_double p, t_double a, t_double b, t_double t, t_double pmin, t_double pmax)
+// audio thread, start of each vector: take up a new "publish". The bus is claimed here and given
+// up here, between this object's writes, so a bus never has two writers. A claim lost to another
+// object's audio thread isn't retried until the next "publish"
+void bounce_bus_claim(t_bounce *x)
 {
-	t_double denom, atpmax, a2, a1, a0;
-	denom = 2*a*a*t;
-	atpmax = (a*t)-pmax;
-	a2 = (b - a) / (2 * denom);
-	a1 = ((a*t*(a + b)) + (pmax*(a-b))) / denom;
-	a0 = ((b - a)* atpmax * atpmax)/ (2 * denom);
-	return (a2*p*p) + (a1*p) + a0;
+	uint64_t asks = __atomic_load_n(&x->bus_pub_asks, __ATOMIC_ACQUIRE);
+	t_bounce_bus *req;
+	void *none = NULL;
+
+	if(asks == x->bus_pub_taken){
+		return;
+	}
+	x->bus_pub_taken = asks;
+	req = __atomic_load_n(&x->bus_pub_req, __ATOMIC_RELAXED);
+	if(req == x->bus_pub){
+		return;
+	}
+	bounce_bus_release(x);
+	if(req && __atomic_compare_exchange_n(&req->writer, &none, (void *) x, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+		x->bus_pub = req;
+	} else if(req){
+		x->bus_lost = req;
+		qelem_set(x->bus_qelem);
+	}
 }
 
-t_double ptr_correctmin(t_double p, t_double a, t_double b, t_double t, t_double pmin, t_double pmax)
+// give up publishing - audio thread, or once the object is out of the chain. Subscribers keep the
+// last positions
+void bounce_bus_release(t_bounce *x)
 {
-	t_double denom, btpmin, b2, b1, b0;
-	denom = 2*b*b*t;
-	btpmin = b*t-pmin;
-	b2 = (a-b) /(2*denom);
-	b1 = (b*t*(a+b)+(pmin*(b-a)))/ denom;
-	b0 = (a-b)*(btpmin*btpmin)/ (2*denom);	
-	return (b2*p*p) + (b1*p) + b0;
+	if(x->bus_pub){
+		__atomic_store_n(&x->bus_pub->writer, NULL, __ATOMIC_RELEASE);
+		x->bus_pub = NULL;
+	}
 }
 
-void setup_lktables (t_bounce *x, t_int shape)
-{	// create lookup for 1/4 sine and hyperbolic sine cycles -- could add alternative lookups
-	int i;
-	if(shape==0){
-		for(i=0; i< LKTBL_LNGTH; i++){
-			x->sin[i] = sin(PI * i * 0.5 / (LKTBL_LNGTH-1)) ;
-			x->sinh[i] = sinh(PI * i * 0.5 / (LKTBL_LNGTH-1)) ;
+// main thread, via qelem - a "publish" lost its bus between the message and the audio thread
+void bounce_bus_report(t_bounce *x)
+{
+	t_bounce_bus *bus = x->bus_lost;
+
+	if(bus){
+		post("ERROR - bus %s already has a publisher", bounce_bus_names[bus - bounce_buses]->s_name);
+	}
+}
+
+// publisher's audio thread, end of each vector: the positions go into slot block & 1. seq goes odd,
+// the positions go in, seq goes even again - readers retry if it changed under them. Starts from an
+// odd value whatever seq was left at, so a publisher handing over mid-write can't leave a slot
+// looking busy for good
+void bounce_bus_write(t_bounce_bus *bus, uint64_t block, const t_double *loc, t_int count)
+{
+	t_bounce_bus_slot *slot = &bus->slot[block & 1];
+	uint64_t seq = (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) + 1) | 1;
+	t_double v;
+	t_int i;
+
+	__atomic_store_n(&slot->seq, seq, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&slot->block, block, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->count, (uint64_t) count, __ATOMIC_RELAXED);
+	for(i = 0; i < count; i++){
+		v = loc[i];
+		__atomic_store(&slot->loc[i], &v, __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&bus->last, block & 1, __ATOMIC_RELEASE);
+}
+
+// subscriber's audio thread: copy a slot into bus_new and say which of the publisher's vectors it
+// held. 0 if it was caught mid-write BUS_TRIES times
+t_bool bounce_bus_copy(t_bounce *x, t_bounce_bus_slot *slot, uint64_t *block)
+{
+	uint64_t s0, s1, n, b;
+	t_int tries, i;
+
+	for(tries = 0; tries < BUS_TRIES; tries++){
+		s0 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		b = __atomic_load_n(&slot->block, __ATOMIC_RELAXED);
+		n = __atomic_load_n(&slot->count, __ATOMIC_RELAXED);
+		n = n < MAX_VOICES ? n : MAX_VOICES;
+		for(i = 0; i < (t_int) n; i++){
+			__atomic_load(&slot->loc[i], &x->bus_new[i], __ATOMIC_RELAXED);
+		}
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		s1 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+		if(s0 == s1 && !(s0 & 1)){
+			x->bus_new_count = (t_int) n;
+			*block = b;
+			return 1;
 		}
 	}
+	return 0;
 }
 
-double bounce_alimit(double a, double width, double t){
-	// gradient can't be more than f/sr - (f @ width)
-	// I've limited further to avoid antialiasing at higher freqs
+// audio thread, start of each vector (before "record" sees it): latch "subscribe" and copy the
+// publisher's vector before this one into bus_new - or, if it's out of step, its last finished one
+// as long as that isn't this vector's. Nothing is read on the first vector after dsp64, so the order
+// the two objects run in never shows. A publisher preempted mid-write can't hold this up - after
+// BUS_TRIES the last copy is used again
+void bounce_bus_read(t_bounce *x)
+{
+	t_bounce_bus *bus;
+	uint64_t block, want = x->bus_block - 1;
+	t_int i;
 
-	double amax, amin;
-	amax = width / (4 * t);  
-	if(amax < 2 ) amax = 2;
-	amin = amax/(amax-1);	// cover downward gradient
-	if(a>amax) {
-		return amax;
-	} else if (a < amin) {
-		return amin;
-	} else {
-		return a;
+	bus = x->bus_sub = __atomic_load_n(&x->bus_sub_req, __ATOMIC_ACQUIRE);
+	if(!bus){
+		x->bus_new_count = 0;
+		return;
+	}
+	if(x->bus_block){
+		if(bounce_bus_copy(x, &bus->slot[want & 1], &block) && block == want){
+			return;
+		}
+		if(bounce_bus_copy(x, &bus->slot[__atomic_load_n(&bus->last, __ATOMIC_ACQUIRE)], &block)
+			&& block != x->bus_block){
+			return;
+		}
+	}
+	for(i = 0; i < x->bus_count; i++){
+		x->bus_new[i] = x->bus_in[i];
+	}
+	x->bus_new_count = x->bus_count;
+}
+
+// audio thread, after the "record" snapshot: ramp each bus voice from the last read to this one
+// over the vector. Voices new to the bus start where they are
+void bounce_bus_ramp(t_bounce *x, long sampleframes)
+{
+	t_double from;
+	t_int i;
+
+	for(i = 0; i < x->bus_new_count; i++){
+		from = i < x->bus_count ? x->bus_in[i] : x->bus_new[i];
+		x->bus_loc[i] = from;
+		x->bus_step[i] = (x->bus_new[i] - from) / sampleframes;
+		x->bus_in[i] = x->bus_new[i];
 	}
+	x->bus_count = x->bus_new_count;
 }
 
 
-double do_shaping (t_bounce *x, t_double lo, t_double hi) 
-// shape comes in as restricted to (-1...-0.05, 0.05 ...1), defines the portion of lookup to use
-// pos between -1 and 1
-{		
-	t_double midpoint, halfwidth, ph, fracph, shaped, pos, shape, shapesign;
-	t_int maxph, intph, sign, v;
-	v = x->curr_v;
-	if (x->shape[v] >= 0.1 || x->shape[v] <= -0.1){		
-		pos = x->ball_loc[v];
-		shape = x->shape[v];
-		// get relative position between bounds for waveshaping lookup
-		midpoint = lo + 0.5f * (hi - lo);
-		halfwidth = midpoint - lo;
-		// prepare phase values for lookups
-		shapesign = sign(shape);
-		shape = fabs(shape);
-		maxph = (t_int)(shape * LKTBL_LNGTH-1);
-		ph = (pos - midpoint) * maxph /  halfwidth;
-		sign = sign(ph);
-		ph = ph * sign;
-		intph = (t_int)ph;
-		fracph = ph - intph;
-		// lookup, scale & lerp
-		if(shapesign<0)	shaped = sign * (x->sinh[intph] * (1.f - fracph) + x->sinh[intph+1] * fracph) / x->sinh[maxph];
-		else  shaped = sign * (x->sin[intph] * (1.f - fracph) + x->sin[intph+1] * fracph) / x->sin[maxph];
-		//now return  waveshaping output scaled to actual bounds
-		return midpoint + shaped * halfwidth;
+/************************************************************
+!!!!!!!!!!!!	INPUT TRACE RECORDING		!!!!!!!!!!!!
+*************************************************************/
+
+// main thread (deferred "record"): stop the trace in progress, start a new one if given a path.
+// If the audio thread is still in the last vector, the new one starts when the stop finishes
+void bounce_record_do(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	x->rec_next = (argc >= 1 && atom_gettype(argv) == A_SYM) ? atom_getsym(argv) : NULL;
+	if(x->rec_file && !x->rec_stopping){
+		bounce_trace_stop(x);
 	}
-	else {
-		return x->ball_loc[v];
+	if(!x->rec_file && x->rec_next){
+		bounce_trace_start(x, x->rec_next);
+		x->rec_next = NULL;
 	}
 }
 
+void bounce_trace_start(t_bounce *x, t_symbol *path)
+{
+	t_trace_header hdr;
+	t_trace_msgslot slot;
+	t_atom busname;
+	t_bounce_bus *bus;
+	t_int numins = 2 + 2 * x->voice_cap, i;
+
+	// REC_RING_MS of every inlet as a signal, block headers (and bus reads) for vectors down to 16
+	// samples, the snapshot
+	x->rec_ring_size = (uint64_t) (REC_RING_MS * 0.001 * x->srate)
+		* (numins * sizeof(double) + (2 * sizeof(t_trace_rec) + sizeof(t_trace_block) + sizeof(t_trace_bus)
+		+ MAX_VOICES * sizeof(double)) / 16 + 1)
+		+ sizeof(t_trace_rec) + sizeof(uint64_t) + TRACE_STATE_VALUES(x->voice_cap) * sizeof(t_double);
+	x->rec_ring = t_getbytes((long) x->rec_ring_size);
+	x->rec_state = (t_double *) t_getbytes(TRACE_STATE_VALUES(x->voice_cap) * sizeof(t_double));
+	if(!x->rec_msgs){
+		x->rec_msgs = (t_trace_msgslot *) t_getbytes(REC_MSG_SLOTS * sizeof(t_trace_msgslot));
+		for(i = 0; x->rec_msgs && i < REC_MSG_SLOTS; i++){
+			x->rec_msgs[i].seq = i;
+		}
+		x->rec_msg_head = x->rec_msg_tail = 0;
+	}
+	x->rec_file = (x->rec_ring && x->rec_state && x->rec_msgs) ? fopen(path->s_name, "wb") : NULL;
+	if(!x->rec_file){
+		post("ERROR - db.bounce~ can't record to %s", path->s_name);
+		if(x->rec_ring){
+			t_freebytes(x->rec_ring, (long) x->rec_ring_size);
+			x->rec_ring = NULL;
+		}
+		if(x->rec_state){
+			t_freebytes(x->rec_state, TRACE_STATE_VALUES(x->voice_cap) * sizeof(t_double));
+			x->rec_state = NULL;
+		}
+		return;
+	}
+	memset(x->rec_ring, 0, x->rec_ring_size);	// touch every page here, not on the audio thread
+	while(bounce_trace_pop(x, &slot));	// anything a message slipped in as the last trace stopped
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+	hdr.version = TRACE_VERSION;
+	hdr.voice_cap = (uint32_t) x->voice_cap;
+	hdr.srate = x->srate;
+	fwrite(&hdr, sizeof(hdr), 1, x->rec_file);
+
+	x->rec_path = path;
+	x->rec_head = x->rec_tail = x->rec_wpos = 0;
+	x->rec_frame = x->rec_gap = x->rec_dropped = x->rec_msg_lost = 0;
+	x->rec_started = 0;
+	__atomic_store_n(&x->rec_on, 1, __ATOMIC_SEQ_CST);	// the audio thread picks it up from here
+	bus = __atomic_load_n(&x->bus_sub_req, __ATOMIC_ACQUIRE);
+	if(bus){		// the bus name isn't in the snapshot - the replay subscribes to feed it
+		atom_setsym(&busname, bounce_bus_names[bus - bounce_buses]);
+		bounce_trace_msg(x, gensym("subscribe"), 1, &busname);
+	}
+	post("db.bounce~: recording to %s", path->s_name);
+}
 
-void 	bounce_PerformWrapper(t_bounce *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+// main thread: no new vectors are recorded from here. The buffers are freed now if the audio
+// thread isn't in one, otherwise by the qelem it sets when it lets go (bounce_trace_flush)
+void bounce_trace_stop(t_bounce *x)
 {
-	if(x->mode==0){
-		bounce_perform64(x, ins, outs, sampleframes, bounce_shaper_voicecalc);
-	} else{
-		bounce_perform64(x, ins, outs, sampleframes, bounce_ptr_voicecalc);
+	__atomic_store_n(&x->rec_on, 0, __ATOMIC_SEQ_CST);
+	x->rec_stopping = 1;
+	if(!__atomic_load_n(&x->rec_busy, __ATOMIC_SEQ_CST)){
+		bounce_trace_finish(x);
 	}
 }
 
+// main thread, once the audio thread has let go: write out the rest, close and free
+void bounce_trace_finish(t_bounce *x)
+{
+	t_symbol *next = x->rec_next;
+
+	bounce_trace_drain(x);
+	fclose(x->rec_file);
+	x->rec_file = NULL;
+	t_freebytes(x->rec_ring, (long) x->rec_ring_size);
+	x->rec_ring = NULL;
+	t_freebytes(x->rec_state, TRACE_STATE_VALUES(x->voice_cap) * sizeof(t_double));
+	x->rec_state = NULL;
+	x->rec_stopping = 0;
+
+	post("db.bounce~: recorded %.2f s to %s", x->rec_frame / x->srate, x->rec_path->s_name);
+	if(x->rec_dropped || x->rec_msg_lost){
+		post("db.bounce~: trace buffers overflowed (%.2f s of signal, %ld messages lost) - replays diverge from there",
+			x->rec_dropped / x->srate, (long) x->rec_msg_lost);
+	}
+	if(next){
+		x->rec_next = NULL;
+		bounce_trace_start(x, next);
+	}
+}
 
-void 	bounce_perform64(t_bounce *x, double **ins, double **outs, long sampleframes, void (*voicemode)(t_bounce *, t_double, t_double, t_double, t_double))
-{	
-	t_double **hz, **symm, **out;
-	t_double *bound_lo, *bound_hi;
-	t_double this_lo, this_hi, width, symm_l, f0, fmax, grad, t;
-	t_int samples, i, v;
+// main thread, via qelem: write out what the audio thread has queued, finish a stop once it has let go
+void bounce_trace_flush(t_bounce *x)
+{
+	bounce_trace_drain(x);
+	if(x->rec_stopping && !__atomic_load_n(&x->rec_busy, __ATOMIC_SEQ_CST)){
+		bounce_trace_finish(x);
+	}
+}
 
-	// Dereference
-	hz = x->hz;
-	symm = x->symm;
-	out = x->out;
-	samples = sampleframes;
+// main thread (qelem, and when stopping): write out the queued messages, then the audio thread's records
+void bounce_trace_drain(t_bounce *x)
+{
+	t_trace_msgslot slot;
+	uint64_t head, tail, at, n;
 
-	// 2 & 3 = Lo & hi
-	if(x->bound_lo_conn){	// if signal connected, point at signal in
-		bound_lo = (t_double *) (ins[0]);
-	} else {				// if not, point at value in bounce object
-		bound_lo = &(x->bound_lo);
+	if(!x->rec_file){
+		return;
+	}
+	while(bounce_trace_pop(x, &slot)){
+		fwrite(&slot.rec, sizeof(t_trace_rec), 1, x->rec_file);
+		fwrite(slot.payload, slot.rec.size, 1, x->rec_file);
+	}
+	head = __atomic_load_n(&x->rec_head, __ATOMIC_ACQUIRE);
+	for(tail = x->rec_tail; tail < head; tail += n){
+		at = tail % x->rec_ring_size;
+		n = head - tail < x->rec_ring_size - at ? head - tail : x->rec_ring_size - at;
+		fwrite(x->rec_ring + at, 1, n, x->rec_file);
 	}
+	__atomic_store_n(&x->rec_tail, tail, __ATOMIC_RELEASE);
+}
 
-	if(x->bound_hi_conn){	// if signal connected, point at signal in
-		bound_hi = (t_double *) (ins[1]);
-	} else {				// if not, point at value in bounce object
-		bound_hi = &(x->bound_hi);
+// any thread: queue a record for the file. Lock free, for any number of message threads and
+// one reader (bounce_trace_pop). Lost if the queue is full
+void bounce_trace_push(t_bounce *x, uint32_t type, const void *payload, uint32_t size)
+{
+	t_trace_msgslot *slot;
+	uint64_t pos, seq;
+
+	pos = __atomic_load_n(&x->rec_msg_head, __ATOMIC_RELAXED);
+	for(;;){
+		slot = &x->rec_msgs[pos & (REC_MSG_SLOTS - 1)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if(seq == pos){
+			if(__atomic_compare_exchange_n(&x->rec_msg_head, &pos, pos + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+				break;
+			}
+		} else if(seq < pos){
+			__atomic_fetch_add(&x->rec_msg_lost, 1, __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n(&x->rec_msg_head, __ATOMIC_RELAXED);
+		}
 	}
+	slot->rec.type = type;
+	slot->rec.size = size;
+	memcpy(slot->payload, payload, size);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	qelem_set(x->rec_qelem);
+}
 
-	// hz inputs,
-	for  (i = 0; i< x->voice_count; i++){
-		if(x->hz_conn[i]){	// if signal connected, point at signal in
-			hz[i] = (t_double *) (ins[i + 2]);
-		} else{				// if not, point at value in drag object
-			hz[i] = &(x->hzFloat[i]);
+// main thread: take the oldest queued record, 0 if there is none
+t_bool bounce_trace_pop(t_bounce *x, t_trace_msgslot *out)
+{
+	t_trace_msgslot *slot = &x->rec_msgs[x->rec_msg_tail & (REC_MSG_SLOTS - 1)];
+
+	if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != x->rec_msg_tail + 1){
+		return 0;
+	}
+	out->rec = slot->rec;
+	memcpy(out->payload, slot->payload, slot->rec.size);
+	__atomic_store_n(&slot->seq, x->rec_msg_tail + REC_MSG_SLOTS, __ATOMIC_RELEASE);
+	x->rec_msg_tail++;
+	return 1;
+}
+
+// message handlers: the message as typed, replayed through the same handler. Stamped with
+// the frames performed so far - it takes effect from the next vector
+void bounce_trace_msg(t_bounce *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	char payload[sizeof(uint64_t) + TRACE_MSGLEN];
+	char *text = payload + sizeof(uint64_t);
+	uint64_t frame;
+	int i, n;
+
+	if(!__atomic_load_n(&x->rec_on, __ATOMIC_ACQUIRE)){
+		return;
+	}
+	frame = __atomic_load_n(&x->rec_frame, __ATOMIC_RELAXED);
+	memcpy(payload, &frame, sizeof(frame));
+	n = snprintf(text, TRACE_MSGLEN, "%s", msg->s_name);
+	for(i = 0; i < argc && n < TRACE_MSGLEN; i++){
+		switch(atom_gettype(argv + i)){
+			case A_LONG: n += snprintf(text + n, TRACE_MSGLEN - n, " %lld", (long long) atom_getlong(argv + i)); break;
+			case A_FLOAT: n += snprintf(text + n, TRACE_MSGLEN - n, " %#.17g", atom_getfloat(argv + i)); break;	// '#' keeps it a float
+			case A_SYM: n += snprintf(text + n, TRACE_MSGLEN - n, " %s", atom_getsym(argv + i)->s_name); break;
 		}
 	}
+	if(n >= TRACE_MSGLEN){
+		n = TRACE_MSGLEN - 1;
+	}
+	bounce_trace_push(x, TRACE_MSG, payload, (uint32_t) (sizeof(uint64_t) + n));
+}
 
-	// symm inputs,
-	for  (i = 0; i< x->voice_count; i++){
-		if(x->symm_conn[i]){	// if signal connected, point at signal in
-			symm[i] = (t_double *) (ins[i + x->voice_count + 2]);
-		} 
+void bounce_trace_float(t_bounce *x, long inlet, double f)
+{
+	t_trace_float rec;
+
+	if(!__atomic_load_n(&x->rec_on, __ATOMIC_ACQUIRE)){
+		return;
 	}
+	rec.frame = __atomic_load_n(&x->rec_frame, __ATOMIC_RELAXED);
+	rec.inlet = (uint32_t) inlet, rec.pad = 0;
+	rec.value = f;
+	bounce_trace_push(x, TRACE_FLOAT, &rec, sizeof(rec));
+}
+
+// dsp64: signal connections (and vector size / sample rate) from here on
+void bounce_trace_dsp(t_bounce *x, short *count, double samplerate, long maxvectorsize)
+{
+	char payload[sizeof(t_trace_dsp) + 2 + 2 * MAX_VOICES];
+	t_trace_dsp rec;
+	t_int i;
 
-	//  outputs
-	for  (i = 0; i< x->voice_count; i++){
-		out[i] = (t_double *) (outs[i]);
+	if(!__atomic_load_n(&x->rec_on, __ATOMIC_ACQUIRE)){
+		return;
+	}
+	rec.frame = __atomic_load_n(&x->rec_frame, __ATOMIC_RELAXED);
+	rec.srate = samplerate;
+	rec.vectorsize = (uint32_t) maxvectorsize;
+	rec.numins = (uint32_t) (2 + 2 * x->voice_cap);
+	memcpy(payload, &rec, sizeof(rec));
+	for(i = 0; i < (t_int) rec.numins; i++){
+		payload[sizeof(rec) + i] = count[i] != 0;
 	}
+	bounce_trace_push(x, TRACE_DSP, payload, (uint32_t) (sizeof(rec) + rec.numins));
+}
 
-	// Loop through samples in vector performing audio calcs
-	while(samples--){
-	
-		// enforce legal values for bounds
-		if (*bound_lo > *bound_hi - THINNESTPIPE){
-			*bound_hi = (t_double) (*bound_lo + ((x->voice_count + 1) * THINNESTPIPE));
-		}
-		// Loop through voices
-		this_lo = *bound_lo;
-		for(x->curr_v=0; x->curr_v < x->voice_count; x->curr_v++){			
-			v = x->curr_v;
-			// hi bound is next ball's pos @ last sample 
-			if(v == x->voice_count - 1){
-				this_hi = *bound_hi; 			// except last ball which gets the outer hi bound
-			}else{
-				this_hi = x->ball_loc[v+1] < *bound_hi ? x->ball_loc[v+1] : *bound_hi ;
-			}
+// the state a replay starts from, TRACE_STATE_VALUES(voice_cap) doubles. save = 1 copies the
+// object into s, 0 restores it from s. One list for both so the layout can't drift
+#define TRACE_FIELD(f) if(save) s[n++] = (t_double) (f); else (f) = s[n++]
+void bounce_trace_state(t_bounce *x, t_double *s, t_bool save)
+{
+	t_int n = 0, v, j;
+
+	TRACE_FIELD(x->srate);
+	TRACE_FIELD(x->fmax);
+	TRACE_FIELD(x->bound_lo);
+	TRACE_FIELD(x->bound_hi);
+	TRACE_FIELD(x->bound_lo_conn);
+	TRACE_FIELD(x->bound_hi_conn);
+	TRACE_FIELD(x->mode);
+	TRACE_FIELD(x->mode_req);
+	TRACE_FIELD(x->voice_count);
+	TRACE_FIELD(x->voice_req);
+	TRACE_FIELD(x->fm_on);
+	TRACE_FIELD(x->fm_run);
+	TRACE_FIELD(x->fm_interval);
+	TRACE_FIELD(x->fm_count);
+	TRACE_FIELD(x->fm_interp);
+	TRACE_FIELD(x->lfo_on);
+	TRACE_FIELD(x->lfo_run);
+	TRACE_FIELD(x->lfo_dec);
+	TRACE_FIELD(x->lfo_count);
+	TRACE_FIELD(x->lfo_rate);
+	TRACE_FIELD(x->bus_lo);
+	TRACE_FIELD(x->bus_hi);
+	TRACE_FIELD(x->bus_count);
+	TRACE_FIELD(x->bus_block);
+	TRACE_FIELD(x->gov_level);
+	TRACE_FIELD(x->gov_run);
+	for(v = 0; v < x->voice_cap; v++){
+		TRACE_FIELD(x->hzFloat[v]);
+		TRACE_FIELD(x->grad[v]);
+		TRACE_FIELD(x->shape[v]);
+		TRACE_FIELD(x->ball_loc[v]);
+		TRACE_FIELD(x->direction[v]);
+		TRACE_FIELD(x->dcblock_on[v]);
+		TRACE_FIELD(x->dc_prev_in[v]);
+		TRACE_FIELD(x->dc_prev_out[v]);
+		TRACE_FIELD(x->gain[v]);
+		TRACE_FIELD(x->gain_target[v]);
+		TRACE_FIELD(x->last_out[v]);
+		TRACE_FIELD(x->fm_sum[v]);
+		TRACE_FIELD(x->fm_step[v]);
+		TRACE_FIELD(x->lfo_val[v]);
+		TRACE_FIELD(x->lfo_step[v]);
+		TRACE_FIELD(x->hz_conn[v]);
+		TRACE_FIELD(x->symm_conn[v]);
+	}
+	for(v = 0; v < x->voice_cap; v++){
+		for(j = 0; j < x->voice_cap; j++){
+			TRACE_FIELD(x->fm[v][j]);
+		}
+	}
+	for(v = 0; v < MAX_VOICES; v++){
+		TRACE_FIELD(x->bus_in[v]);
+		for(j = 0; j < x->voice_cap; j++){
+			TRACE_FIELD(x->busfm[v][j]);
+		}
+	}
+	if(!save){
+		x->fade_inc = 1000. / (FADE_MS * x->srate);
+		x->lfo_dcgain = pow(DCBLOCK_GAIN, x->lfo_dec);
+	}
+}
+#undef TRACE_FIELD
 
-			if(this_lo >= this_hi - THINNESTPIPE){
-				this_hi = this_lo + THINNESTPIPE;
-			}
-			width = this_hi - this_lo;
-			// get freq from freq modulation
-			f0 = bounce_fmcalc (x, v);
-			// determine freq & gradient limits at this width
-			fmax = x->fmax * width;
-			// apply limits
-			if(f0>fmax) {
-				f0 = fmax;
-			} else if (f0 < FMIN) {
-				f0 = FMIN;
-			}
-			t = f0/x->srate;
+// audio thread: copy into the ring at byte position pos, wrapping
+void bounce_trace_write(t_bounce *x, uint64_t pos, const void *src, uint64_t n)
+{
+	uint64_t at = pos % x->rec_ring_size, first = x->rec_ring_size - at;
 
-			if(x->symm_conn[v]) { // WITH SYMM SIGNALS CONNECTED
-				if(*x->symm[v] < SYMMMIN) symm_l = SYMMMIN;
-				else if (*x->symm[v] > SYMMMAX) symm_l = SYMMMAX;
-				else symm_l = *x->symm[v];
+	if(n <= first){
+		memcpy(x->rec_ring + at, src, n);
+	} else {
+		memcpy(x->rec_ring + at, src, first);
+		memcpy(x->rec_ring, (const char *) src + first, n - first);
+	}
+}
 
-				grad = bounce_alimit(1/symm_l, width, t);
-			} else {	// WITHOUT SYMM SIGNALS CONNECTED
-				grad = bounce_alimit(x->grad[v], width, t);
-			}
+void bounce_trace_append(t_bounce *x, const void *src, uint64_t n)
+{
+	bounce_trace_write(x, x->rec_wpos, src, n);
+	x->rec_wpos += n;
+}
 
-			// mode-specific voice calcs
-			voicemode(x, this_lo, this_hi, grad, t);
+// audio thread, before the kernel: the state snapshot on the
+// first vector, then what was read from the bus and this vector's signal inputs. Constant inputs
+// are stored as one value. Returns 1 while recording - bounce_trace_end() must follow the kernel
+t_bool bounce_trace_begin(t_bounce *x, double **ins, long sampleframes)
+{
+	t_trace_rec rec;
+	t_trace_gap gap;
+	t_trace_bus bus;
+	uint64_t frame, space, values = 0;
+	t_int numins = 2 + 2 * x->voice_cap, conn, i, j;
+
+	if(!__atomic_load_n(&x->rec_on, __ATOMIC_RELAXED)){
+		return 0;
+	}
+	__atomic_store_n(&x->rec_busy, 1, __ATOMIC_SEQ_CST);
+	if(!__atomic_load_n(&x->rec_on, __ATOMIC_SEQ_CST)){	// "record" stopped it meanwhile
+		__atomic_store_n(&x->rec_busy, 0, __ATOMIC_RELEASE);
+		qelem_set(x->rec_qelem);	// the stop may be waiting for this
+		return 0;
+	}
+	frame = x->rec_frame;
+	__atomic_store_n(&x->rec_frame, frame + sampleframes, __ATOMIC_RELAXED);
+
+	if(!x->rec_started){	// ring is empty and sized for this
+		bounce_trace_state(x, x->rec_state, 1);
+		rec.type = TRACE_STATE;
+		rec.size = (uint32_t) (sizeof(uint64_t) + TRACE_STATE_VALUES(x->voice_cap) * sizeof(t_double));
+		bounce_trace_append(x, &rec, sizeof(rec));
+		bounce_trace_append(x, &frame, sizeof(frame));
+		bounce_trace_append(x, x->rec_state, rec.size - sizeof(uint64_t));
+		x->rec_started = 1;
+	}
 
-				// next ball's lo bound is this ball's pos (limited to outer bound)
-			this_lo = x->ball_loc[v] > *bound_lo ? x->ball_loc[v]: *bound_lo;
+	x->rec_blk.frame = frame;
+	x->rec_blk.frames = (uint32_t) sampleframes;
+	x->rec_blk.conn = x->rec_blk.constant = 0;
+	x->rec_blk.checksum = x->rec_blk.perform_ns = 0;
+	for(i = 0; i < numins; i++){
+		conn = i == 0 ? x->bound_lo_conn : i == 1 ? x->bound_hi_conn
+			: i < x->voice_cap + 2 ? x->hz_conn[i - 2] : x->symm_conn[i - 2 - x->voice_cap];
+		if(!conn){
+			continue;
+		}
+		x->rec_blk.conn |= 1u << i;
+		for(j = 1; j < sampleframes && ins[i][j] == ins[i][0]; j++);
+		if(j == sampleframes){
+			x->rec_blk.constant |= 1u << i;
+			values++;
+		} else {
+			values += sampleframes;
+		}
+	}
 
-			// apply dcblock if on
-			if(x->dcblock_on[v]){
-				*(out[v]) = bounce_dcblock(*(out[v]),&x->dc_prev_in[v], &x->dc_prev_out[v], (t_double) DCBLOCK_GAIN);
-			} 
+	space = x->rec_ring_size - (x->rec_wpos - __atomic_load_n(&x->rec_tail, __ATOMIC_ACQUIRE));
+	x->rec_block_ok = 3 * sizeof(rec) + sizeof(gap) + sizeof(bus) + sizeof(t_trace_block)
+		+ (values + x->bus_new_count) * sizeof(double) <= space;
+	if(!x->rec_block_ok){	// main thread is behind - drop the block, note the gap with the next one
+		x->rec_gap += sampleframes;
+		x->rec_dropped += sampleframes;
+		return 1;
+	}
+	if(x->rec_gap){
+		rec.type = TRACE_GAP, rec.size = sizeof(gap);
+		gap.frame = frame - x->rec_gap, gap.frames = x->rec_gap;
+		bounce_trace_append(x, &rec, sizeof(rec));
+		bounce_trace_append(x, &gap, sizeof(gap));
+		x->rec_gap = 0;
+	}
+	if(x->bus_sub){
+		rec.type = TRACE_BUS, rec.size = (uint32_t) (sizeof(bus) + x->bus_new_count * sizeof(double));
+		bus.frame = frame, bus.count = (uint32_t) x->bus_new_count, bus.pad = 0;
+		bounce_trace_append(x, &rec, sizeof(rec));
+		bounce_trace_append(x, &bus, sizeof(bus));
+		bounce_trace_append(x, x->bus_new, x->bus_new_count * sizeof(double));
+	}
+	rec.type = TRACE_BLOCK;
+	rec.size = (uint32_t) (sizeof(t_trace_block) + values * sizeof(double));
+	bounce_trace_append(x, &rec, sizeof(rec));
+	x->rec_block_at = x->rec_wpos;		// filled in by bounce_trace_end()
+	x->rec_wpos += sizeof(t_trace_block);
+	for(i = 0; i < numins; i++){
+		if(x->rec_blk.conn & (1u << i)){
+			bounce_trace_append(x, ins[i], (x->rec_blk.constant & (1u << i) ? 1 : sampleframes) * sizeof(double));
 		}
-		
-		//store hz @ end of vector
-		for(i=0; i < x->voice_count; i++){
-			x->hzFloat[i] = *hz[i];
-		}		
-		//increment pointers for next sample
-		if(x->bound_lo_conn) bound_lo++;
-		if(x->bound_hi_conn) bound_hi++;
-		for(i=0; i < x->voice_count; i++){
-			if(x->hz_conn[i]) hz[i]++;
-			if(x->symm_conn[i]) symm[i]++;
-			 out[i]++;
+	}
+	return 1;
+}
+
+// audio thread, after the kernel: output checksum & timing into the block, hand it to the main thread
+void bounce_trace_end(t_bounce *x, double **outs, long sampleframes, double elapsed_ns)
+{
+	if(x->rec_block_ok){
+		x->rec_blk.checksum = bounce_trace_checksum(outs, x->voice_cap, sampleframes);
+		x->rec_blk.perform_ns = (uint64_t) elapsed_ns;
+		bounce_trace_write(x, x->rec_block_at, &x->rec_blk, sizeof(t_trace_block));
+	}
+	__atomic_store_n(&x->rec_head, x->rec_wpos, __ATOMIC_RELEASE);
+	__atomic_store_n(&x->rec_busy, 0, __ATOMIC_RELEASE);
+	qelem_set(x->rec_qelem);
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	AUDIO CALC FUNCTIONS		!!!!!!!!!!!!
+*************************************************************/
+
+void setup_lktables (t_bounce *x, t_int shape)
+{	// create lookup for 1/4 sine and hyperbolic sine cycles -- could add alternative lookups
+	int i;
+	if(shape==0){
+		for(i=0; i< LKTBL_LNGTH; i++){
+			x->sin[i] = sin(PI * i * 0.5 / (LKTBL_LNGTH-1)) ;
+			x->sinh[i] = sinh(PI * i * 0.5 / (LKTBL_LNGTH-1)) ;
 		}
 	}
 }
 
 
+// start a voice near the bottom of its bounds (the ball below it, or the ensemble's lower bound)
+void bounce_voice_init (t_bounce *x, t_int v)
+{
+	t_double lo = v == 0 ? x->bound_lo : x->ball_loc[v-1];
 
-void bounce_ptr_voicecalc (t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t)
+	x->ball_loc[v] = lo + THINNESTPIPE;
+	x->direction[v] = v % 2 ? -1 : 1;	// alternate up and down
+	x->dc_prev_in[v] = x->dc_prev_out[v] = 0.f;
+	x->fm_sum[v] = 1, x->fm_step[v] = 0;
+	x->lfo_val[v] = x->ball_loc[v], x->lfo_step[v] = 0;
+}
+
+// apply "voices" & "mode" requests and governor level changes - audio thread, start of each
+// vector, no allocation. The requests are read once: the message thread may change them meanwhile
+void bounce_reconfigure (t_bounce *x)
 {
-	t_double b;
-	t_double *p;
-	t_double *out;
-	t_int v;
-	t_int *dir;
-
-	v = x->curr_v;
-	dir = &x->direction[v];
-	p = &x->ball_loc[v];
-	out = x->out[v];
-
-	if(*dir == 1){ //rising
-		*p = *p + (2 * grad * t);
-		if(*p > hi - grad*t){ // TRANSITION REGION
-			b = -grad/(grad-1);
-			*out = (t_double) ptr_correctmax(*p, grad, b, t, lo, hi);
-			*p = (hi + (*p - hi)*(b/grad));
-			*dir = -1;
-			if(v < x->voice_count - 2){
-				*(dir+1) = 1;
-			}
-		} else { // linear
-			*out = (t_double) *p;
+	t_int v, on, silent, voice_req = x->voice_req, mode_req = x->mode_req;
+	t_int gov_req = __atomic_exchange_n(&x->gov_req, -1, __ATOMIC_ACQ_REL);
+	t_bool fm;
+
+	// "governor 0" - the level only changes here, so it can't race bounce_governor()
+	if(gov_req >= 0 && gov_req != x->gov_level){
+		x->gov_level = gov_req;
+		x->gov_calm = 0;
+		qelem_set(x->gov_qelem);
+	}
+
+	// mode or voice count change, or a governor level change that would click: fade everything
+	// out on the old kernel, then swap and fade back in. Voices that keep running through a count
+	// change get a new neighbour or lose one - their bounds (and shaping) would step under them
+	for(v = 0; v < x->voice_count && x->gain[v] == 0; v++);
+	silent = v == x->voice_count;
+	if(mode_req != x->mode && silent){
+		x->mode = mode_req;
+	}
+	if(voice_req != x->voice_count && silent){
+		for(v = x->voice_count; v < voice_req; v++){
+			bounce_voice_init(x, v);
 		}
-	} else { // counting down
-		b = -grad/(grad-1);
-		*p = *p + (2 * b * t);
-		if(*p < lo - b*t){ // TRANSITION REGION
-			*out = (t_double)ptr_correctmin(*p, grad, b, t, lo, hi);
-				*p = (lo + (*p - lo)*(grad/b));
-				*dir = 1;
-				if(v > 0){
-					*(dir-1) = -1;
-				}
-		} else { // linear
-			*out = (t_double)*p;
+		x->voice_count = voice_req;
+	}
+	if(x->gov_level != x->gov_run && (silent || !bounce_governor_clicks(x))){
+		x->gov_run = x->gov_level;
+	}
+
+	on = mode_req == x->mode && voice_req == x->voice_count && x->gov_level == x->gov_run;
+	for(v = 0; v < x->voice_cap; v++){
+		x->gain_target[v] = (v < x->voice_count && on) ? 1 : 0;
+	}
+
+	// cross modulation back on: the sums start from unmodulated, where the voices have been, and
+	// control rate fm ramps from there to its first update
+	fm = x->fm_on;
+	if(fm != x->fm_run){
+		x->fm_run = fm;
+		if(fm){
+			for(v = 0; v < x->voice_cap; v++){
+				x->fm_sum[v] = 1, x->fm_step[v] = 0;
+			}
+			x->fm_count = 0;
 		}
 	}
 
-	if(*p > hi) {
-		*p = hi, *dir = -1;
-	} else if(*p < lo) {
-		*p = lo, *dir = +1;
+	// "lfo" on: start the ramps from where the outputs are, with a full rate vector to find the
+	// voices' rates. off: fresh control rate fm
+	if(x->lfo_on != x->lfo_run){
+		x->lfo_run = x->lfo_on;
+		if(x->lfo_run){
+			for(v = 0; v < x->voice_cap; v++){
+				x->lfo_val[v] = x->last_out[v], x->lfo_step[v] = 0;
+			}
+			x->lfo_count = 0;
+			x->lfo_rate = x->srate;
+		} else {
+			x->fm_count = 0;
+		}
 	}
+
+	bounce_bus_claim(x);
+
+	// governor levels 2 & 3
+	x->fm_interval_run = (x->gov_run >= 2 && x->fm_interval < GOV_FMRATE) ? GOV_FMRATE : x->fm_interval;
+	x->shape_min = x->gov_run >= 3 ? GOV_SHAPE_MIN : SHAPE_MIN;
 }
 
 
+// monotonic time for the governor, safe to call from the audio thread
+double bounce_clock_ns (void)
+{
+#ifdef WIN_VERSION
+	LARGE_INTEGER t;
+	QueryPerformanceCounter(&t);
+	return (double) t.QuadPart * bounce_clock_scale;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+// does stepping to this level save anything with the current settings?
+t_bool bounce_governor_useful (t_bounce *x, t_int level)
+{
+	switch(level){
+		case 1: return x->mode == 1;									// ptr -> plain transitions
+		case 2: return x->fm_run && x->fm_interval < GOV_FMRATE && !x->lfo_run;	// control rate fm
+		case 3: return x->mode == 0;									// only the shaper shapes
+		default: return 1;
+	}
+}
 
-void bounce_shaper_voicecalc (t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t)
+// would switching from gov_run to gov_level step the output? ptr <-> plain transitions (level 1)
+// in mode 1, and in mode 0 light shaping on/off (level 3) if a voice is lightly shaped. Control
+// rate fm (level 2) only changes how smoothly the speeds move
+t_bool bounce_governor_clicks (t_bounce *x)
 {
-	t_double b, b_over_a;
-	t_double *p;
-	t_double *out;
 	t_int v;
-	t_int *dir;
-
-	v = x->curr_v;
-	dir = &x->direction[v];
-	p = &x->ball_loc[v];
-	out = x->out[v];
-
-	//cursor movement calcs
-	if(*dir == 1){ //rising
-		*p = *p + (2 * grad * t);
-		if(*p >= hi){ // TRANSITION
-			b_over_a = -1/(grad-1);
-			*p = (hi + (*p - hi)*b_over_a);
-			*dir = -1;
-			if(v < x->voice_count - 2){
-				*(dir+1) = 1;
-			}
+
+	if(x->mode == 1){
+		return (x->gov_run >= 1) != (x->gov_level >= 1);
+	}
+	if((x->gov_run >= 3) == (x->gov_level >= 3)){
+		return 0;
+	}
+	for(v = 0; v < x->voice_count; v++){
+		if(fabs(x->shape[v]) >= SHAPE_MIN && fabs(x->shape[v]) < GOV_SHAPE_MIN){
+			return 1;
 		}
-	} else { // counting down
-		b = -grad/(grad-1);
-		*p = *p + (2 * b * t);
-		if(*p <= lo){ // TRANSITION
-			*p = (lo + (*p - lo)*(grad/b));
-			*dir = 1;
-			if(v > 0){
-				*(dir-1) = -1;
-			}
+	}
+	return 0;
+}
+
+// audio thread, after each vector: step quality down when over budget, back up (slowly) when
+// well under it. Levels that wouldn't change anything are skipped
+void bounce_governor (t_bounce *x, double elapsed_ns, long sampleframes)
+{
+	t_int level = x->gov_level;
+
+	x->gov_load += GOV_SMOOTH * (elapsed_ns * x->srate / (sampleframes * 1e9) - x->gov_load);
+	if(x->gov_wait > 0){
+		x->gov_wait--;
+		return;
+	}
+
+	if(x->gov_load > x->gov_budget){
+		x->gov_calm = 0;
+		while(++level < GOV_LEVELS && !bounce_governor_useful(x, level));
+	} else if(x->gov_load < x->gov_budget * GOV_HYST && level > 0){
+		if(++x->gov_calm < GOV_HOLD_MS * 0.001 * x->srate / sampleframes){
+			return;
 		}
+		x->gov_calm = 0;
+		while(--level > 0 && !bounce_governor_useful(x, level));
+	} else {
+		x->gov_calm = 0;
+		return;
+	}
+
+	if(level >= 0 && level < GOV_LEVELS && level != x->gov_level){
+		x->gov_level = level;
+		x->gov_wait = GOV_SETTLE;
+		qelem_set(x->gov_qelem);
 	}
+}
+
+// main thread, via qelem - post the governor's state
+void bounce_governor_report (t_bounce *x)
+{
+	post("db.bounce~ governor %s: level %ld (%s), load %.0f%% of budget %.0f%%", x->gov_on ? "on" : "off",
+		(long) x->gov_level, bounce_gov_names[x->gov_level], x->gov_load * 100, x->gov_budget * 100);
+}
+
 
-	if(*p > hi) {
-		*p = hi, *dir = -1;
-	} else if(*p < lo) {
-		*p = lo, *dir = +1;
+void 	bounce_PerformWrapper(t_bounce *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+{
+	double start, elapsed = 0;
+	t_int kernel;
+	t_bool rec;
+
+	bounce_bus_read(x);		// "subscribe" - an input like the inlets, so before "record"
+	rec = bounce_trace_begin(x, ins, sampleframes);	// "record" - inputs as the kernel reads them
+	bounce_reconfigure(x);
+	if(rec){
+		x->rec_blk.gov_level = (int32_t) x->gov_level;	// with "governor 0" applied
+	}
+	bounce_bus_ramp(x, sampleframes);
+	kernel = (x->gov_run >= 1 && x->mode == 1) ? KERNEL_PLAIN : x->mode;
+	if(x->lfo_run){
+		kernel += KERNEL_LFO;
+	}
+
+	if(x->gov_on || rec){
+		start = bounce_clock_ns();
+		bounce_kernels[kernel](x, ins, outs, sampleframes);
+		elapsed = bounce_clock_ns() - start;
+		if(x->gov_on){
+			bounce_governor(x, elapsed, sampleframes);
+		}
+	} else {
+		bounce_kernels[kernel](x, ins, outs, sampleframes);
+	}
+	if(x->bus_pub){
+		bounce_bus_write(x->bus_pub, x->bus_block, x->ball_loc, x->voice_count);
+	}
+	x->bus_block++;
+	if(rec){
+		bounce_trace_end(x, outs, sampleframes, elapsed);
 	}
-	*out = (t_double) do_shaping(x, lo, hi);
 }
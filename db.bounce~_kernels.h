@@ -0,0 +1,590 @@
+/*
+ *	db.bounce~_kernels.h
+ *	AUTHOR:			Daniel Bennett
+ *	DESCRIPTION:	The per-sample audio kernels for db.bounce~ (movement, FM sum,
+ *					shaping, DC block, PTR correction, voice fades), included once
+ *					from db.bounce~.c. The entry points are bounce_perform_shaper,
+ *					bounce_perform_ptr and bounce_perform_plain, and the same three
+ *					decimated for "lfo" (bounce_perform_lfo_shaper etc.); the rest is
+ *					static inline so it inlines into them.
+ */
+
+#ifndef DB_BOUNCE_KERNELS_H
+#define DB_BOUNCE_KERNELS_H
+
+static inline t_double bounce_dcblock(t_double input, t_double *lastinput, t_double *lastoutput, t_double gain)
+{
+	t_double output;
+	output = input - *lastinput + gain * *lastoutput;
+	*lastinput  = input;
+	*lastoutput = output;
+	return output;
+}
+
+// sum of modulations into a voice from the other balls' positions, and the subscribed bus's (1 = unmodulated)
+static inline t_double bounce_fmsum (t_bounce *x, t_int curr_voice)
+{
+	t_double  modsum;
+	t_int i;
+	modsum = 1;
+	for(i =0; i <x->voice_count; i++){
+		if(x->fm[i][curr_voice] != 0){	//i!=curr_voice &&
+			modsum += x->ball_loc[i] * x->fm[i][curr_voice];
+		}
+	}
+	for(i =0; i <x->bus_count; i++){
+		if(x->busfm[i][curr_voice] != 0){
+			modsum += x->bus_loc[i] * x->busfm[i][curr_voice];
+		}
+	}
+	return modsum;
+}
+
+// control rate FM ("fmrate" > 1): every fm_interval samples work out the sum for each
+// voice and set a ramp to reach it by the next update (or jump to it if fminterp is off)
+static inline void bounce_fm_tick (t_bounce *x)
+{
+	t_double target;
+	t_int v;
+	if(--x->fm_count > 0 && x->fm_count < x->fm_interval_run){
+		return;
+	}
+	x->fm_count = x->fm_interval_run;
+	for(v = 0; v < x->voice_count; v++){
+		target = bounce_fmsum(x, v);
+		if(x->fm_interp){
+			x->fm_step[v] = (target - x->fm_sum[v]) / x->fm_interval_run;
+		} else {
+			x->fm_sum[v] = target, x->fm_step[v] = 0;
+		}
+	}
+}
+
+static inline t_double bounce_fmcalc (t_bounce *x, t_int curr_voice, t_bool ramp)
+{
+	t_double  modsum, modhz;
+	if(x->fm_run){
+		if(ramp){	// control rate - follow the ramp set by bounce_fm_tick
+			modsum = x->fm_sum[curr_voice] += x->fm_step[curr_voice];
+		} else {
+			modsum = x->fm_sum[curr_voice] = bounce_fmsum(x, curr_voice);
+		}
+		// apply modulation to freq of this voice
+		modhz = fabs(*(x->hz[curr_voice]) * modsum);
+		modhz = modhz < 0 ? 0 : modhz;
+		return modhz;
+	} else {
+		return *x->hz[curr_voice];
+	}
+}
+
+// Correction functions for Polynomial Transition Region algorithm
+static inline t_double ptr_correctmax(t_double p, t_double a, t_double b, t_double t, t_double pmin, t_double pmax)
+{
+	t_double denom, atpmax, a2, a1, a0;
+	denom = 2*a*a*t;
+	atpmax = (a*t)-pmax;
+	a2 = (b - a) / (2 * denom);
+	a1 = ((a*t*(a + b)) + (pmax*(a-b))) / denom;
+	a0 = ((b - a)* atpmax * atpmax)/ (2 * denom);
+	return (a2*p*p) + (a1*p) + a0;
+}
+
+static inline t_double ptr_correctmin(t_double p, t_double a, t_double b, t_double t, t_double pmin, t_double pmax)
+{
+	t_double denom, btpmin, b2, b1, b0;
+	denom = 2*b*b*t;
+	btpmin = b*t-pmin;
+	b2 = (a-b) /(2*denom);
+	b1 = (b*t*(a+b)+(pmin*(b-a)))/ denom;
+	b0 = (a-b)*(btpmin*btpmin)/ (2*denom);
+	return (b2*p*p) + (b1*p) + b0;
+}
+
+static inline double bounce_alimit(double a, double width, double t){
+	// gradient can't be more than f/sr - (f @ width)
+	// I've limited further to avoid antialiasing at higher freqs
+
+	double amax, amin;
+	amax = width / (4 * t);
+	if(amax < 2 ) amax = 2;
+	amin = amax/(amax-1);	// cover downward gradient
+	if(a>amax) {
+		return amax;
+	} else if (a < amin) {
+		return amin;
+	} else {
+		return a;
+	}
+}
+
+
+static inline double do_shaping (t_bounce *x, t_double lo, t_double hi)
+// shape comes in as restricted to (-1...-0.05, 0.05 ...1), defines the portion of lookup to use
+// pos between -1 and 1
+{
+	t_double midpoint, halfwidth, ph, fracph, shaped, pos, shape, shapesign;
+	t_int maxph, intph, sign, v;
+	v = x->curr_v;
+	if (x->shape[v] >= x->shape_min || x->shape[v] <= -x->shape_min){
+		pos = x->ball_loc[v];
+		shape = x->shape[v];
+		// get relative position between bounds for waveshaping lookup
+		midpoint = lo + 0.5f * (hi - lo);
+		halfwidth = midpoint - lo;
+		// prepare phase values for lookups
+		shapesign = sign(shape);
+		shape = fabs(shape);
+		maxph = (t_int)(shape * LKTBL_LNGTH-1);
+		ph = (pos - midpoint) * maxph /  halfwidth;
+		sign = sign(ph);
+		ph = ph * sign;
+		intph = (t_int)ph;
+		fracph = ph - intph;
+		// lookup, scale & lerp
+		if(shapesign<0)	shaped = sign * (x->sinh[intph] * (1.f - fracph) + x->sinh[intph+1] * fracph) / x->sinh[maxph];
+		else  shaped = sign * (x->sin[intph] * (1.f - fracph) + x->sin[intph+1] * fracph) / x->sin[maxph];
+		//now return  waveshaping output scaled to actual bounds
+		return midpoint + shaped * halfwidth;
+	}
+	else {
+		return x->ball_loc[v];
+	}
+}
+
+
+static inline void bounce_ptr_voicecalc (t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t)
+{
+	t_double b;
+	t_double *p;
+	t_double *out;
+	t_int v;
+	t_int *dir;
+
+	v = x->curr_v;
+	dir = &x->direction[v];
+	p = &x->ball_loc[v];
+	out = x->out[v];
+
+	if(*dir == 1){ //rising
+		*p = *p + (2 * grad * t);
+		if(*p > hi - grad*t){ // TRANSITION REGION
+			b = -grad/(grad-1);
+			*out = (t_double) ptr_correctmax(*p, grad, b, t, lo, hi);
+			*p = (hi + (*p - hi)*(b/grad));
+			*dir = -1;
+			if(v < x->voice_count - 2){
+				*(dir+1) = 1;
+			}
+		} else { // linear
+			*out = (t_double) *p;
+		}
+	} else { // counting down
+		b = -grad/(grad-1);
+		*p = *p + (2 * b * t);
+		if(*p < lo - b*t){ // TRANSITION REGION
+			*out = (t_double) ptr_correctmin(*p, grad, b, t, lo, hi);
+				*p = (lo + (*p - lo)*(grad/b));
+				*dir = 1;
+				if(v > 0){
+					*(dir-1) = -1;
+				}
+		} else { // linear
+			*out = (t_double)*p;
+		}
+	}
+
+	if(*p > hi) {
+		*p = hi, *dir = -1;
+	} else if(*p < lo) {
+		*p = lo, *dir = +1;
+	}
+}
+
+
+// plain (non bandlimited) transitions - the shaper without shaping, used by the governor in place of PTR
+static inline void bounce_plain_voicecalc (t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t)
+{
+	t_double b, b_over_a;
+	t_double *p;
+	t_double *out;
+	t_int v;
+	t_int *dir;
+
+	v = x->curr_v;
+	dir = &x->direction[v];
+	p = &x->ball_loc[v];
+	out = x->out[v];
+
+	//cursor movement calcs
+	if(*dir == 1){ //rising
+		*p = *p + (2 * grad * t);
+		if(*p >= hi){ // TRANSITION
+			b_over_a = -1/(grad-1);
+			*p = (hi + (*p - hi)*b_over_a);
+			*dir = -1;
+			if(v < x->voice_count - 2){
+				*(dir+1) = 1;
+			}
+		}
+	} else { // counting down
+		b = -grad/(grad-1);
+		*p = *p + (2 * b * t);
+		if(*p <= lo){ // TRANSITION
+			*p = (lo + (*p - lo)*(grad/b));
+			*dir = 1;
+			if(v > 0){
+				*(dir-1) = -1;
+			}
+		}
+	}
+
+	if(*p > hi) {
+		*p = hi, *dir = -1;
+	} else if(*p < lo) {
+		*p = lo, *dir = +1;
+	}
+	*out = (t_double) *p;
+}
+
+
+static inline void bounce_shaper_voicecalc (t_bounce *x, t_double lo, t_double hi, t_double grad, t_double t)
+{
+	bounce_plain_voicecalc(x, lo, hi, grad, t);
+	*x->out[x->curr_v] = (t_double) do_shaping(x, lo, hi);
+}
+
+
+// point hz & symm at their signals (or the float values) and the bounds likewise, or at a bus
+// voice for "busbound". lo_inc & hi_inc: how far the bounds move per sample (0 or 1)
+static inline void bounce_inputs(t_bounce *x, double **ins, t_double **bound_lo, t_double **bound_hi, t_int *lo_inc, t_int *hi_inc)
+{
+	t_int i;
+
+	// 2 & 3 = Lo & hi
+	*lo_inc = *hi_inc = 0;
+	if(x->bus_lo >= 0 && x->bus_lo < x->bus_count){	// bus voice, ramping across the vector
+		*bound_lo = &(x->bus_loc[x->bus_lo]);
+	} else if(x->bound_lo_conn){	// if signal connected, point at signal in
+		*bound_lo = (t_double *) (ins[0]), *lo_inc = 1;
+	} else {				// if not, point at value in bounce object
+		*bound_lo = &(x->bound_lo);
+	}
+
+	if(x->bus_hi >= 0 && x->bus_hi < x->bus_count){
+		*bound_hi = &(x->bus_loc[x->bus_hi]);
+	} else if(x->bound_hi_conn){	// if signal connected, point at signal in
+		*bound_hi = (t_double *) (ins[1]), *hi_inc = 1;
+	} else {				// if not, point at value in bounce object
+		*bound_hi = &(x->bound_hi);
+	}
+
+	// hz inputs,
+	for  (i = 0; i< x->voice_count; i++){
+		if(x->hz_conn[i]){	// if signal connected, point at signal in
+			x->hz[i] = (t_double *) (ins[i + 2]);
+		} else{				// if not, point at value in drag object
+			x->hz[i] = &(x->hzFloat[i]);
+		}
+	}
+
+	// symm inputs,
+	for  (i = 0; i< x->voice_count; i++){
+		if(x->symm_conn[i]){	// if signal connected, point at signal in
+			x->symm[i] = (t_double *) (ins[i + x->voice_cap + 2]);
+		}
+	}
+}
+
+// bus voices ("subscribe") to where their ramp is with left samples of the vector to go. A step
+// running past the end of the vector stops at its target: the next vector's isn't known yet
+static inline void bounce_bus_at(t_bounce *x, t_int left)
+{
+	t_int v;
+	for(v = 0; v < x->bus_count; v++){
+		x->bus_loc[v] = x->bus_in[v] - x->bus_step[v] * left;
+	}
+}
+
+// move the whole ensemble on by one step of dec samples (1, or the "lfo" decimation), writing
+// each voice's output to *x->out[v]. The bus voices must already be where they are at the end
+// of the step. ramp = control rate FM is following bounce_fm_tick.
+// rate (if not NULL) gets the highest f0 / width, half the fastest voice's bounce rate in Hz
+static inline void bounce_step(t_bounce *x, t_double *bound_lo, t_double *bound_hi, t_double dec, t_bool ramp, t_double dcgain, t_double *rate, t_bounce_voicecalc voicemode)
+{
+	t_double lo, hi, this_lo, this_hi, width, symm_l, f0, fmax, grad, t;
+	t_int v;
+
+	// enforce legal values for bounds - in locals, the bounds may be an inlet's signal or a bus voice
+	lo = *bound_lo;
+	hi = *bound_hi;
+	if (lo > hi - THINNESTPIPE){
+		hi = (t_double) (lo + ((x->voice_count + 1) * THINNESTPIPE));
+	}
+	// Loop through voices
+	this_lo = lo;
+	for(x->curr_v=0; x->curr_v < x->voice_count; x->curr_v++){
+		v = x->curr_v;
+		// hi bound is next ball's pos @ last sample
+		if(v == x->voice_count - 1){
+			this_hi = hi; 			// except last ball which gets the outer hi bound
+		}else{
+			this_hi = x->ball_loc[v+1] < hi ? x->ball_loc[v+1] : hi ;
+		}
+
+		if(this_lo >= this_hi - THINNESTPIPE){
+			this_hi = this_lo + THINNESTPIPE;
+		}
+		width = this_hi - this_lo;
+		// get freq from freq modulation
+		f0 = bounce_fmcalc (x, v, ramp);
+		// determine freq & gradient limits at this width
+		fmax = x->fmax * width;
+		// apply limits
+		if(f0>fmax) {
+			f0 = fmax;
+		} else if (f0 < FMIN) {
+			f0 = FMIN;
+		}
+		t = f0 * dec / x->srate;
+		if(rate && f0 > *rate * width){
+			*rate = f0 / width;
+		}
+
+		if(x->symm_conn[v]) { // WITH SYMM SIGNALS CONNECTED
+			if(*x->symm[v] < SYMMMIN) symm_l = SYMMMIN;
+			else if (*x->symm[v] > SYMMMAX) symm_l = SYMMMAX;
+			else symm_l = *x->symm[v];
+
+			grad = bounce_alimit(1/symm_l, width, t);
+		} else {	// WITHOUT SYMM SIGNALS CONNECTED
+			grad = bounce_alimit(x->grad[v], width, t);
+		}
+
+		// mode-specific voice calcs
+		voicemode(x, this_lo, this_hi, grad, t);
+
+			// next ball's lo bound is this ball's pos (limited to outer bound)
+		this_lo = x->ball_loc[v] > lo ? x->ball_loc[v]: lo;
+
+		// apply dcblock if on
+		if(x->dcblock_on[v]){
+			*(x->out[v]) = bounce_dcblock(*(x->out[v]),&x->dc_prev_in[v], &x->dc_prev_out[v], dcgain);
+		}
+	}
+}
+
+
+// rate as for bounce_step, over the whole vector
+static inline void bounce_perform64(t_bounce *x, double **ins, double **outs, long sampleframes, t_double *rate, t_bounce_voicecalc voicemode)
+{
+	t_double **hz, **symm, **out;
+	t_double *bound_lo, *bound_hi;
+	t_int samples, i, lo_inc, hi_inc;
+
+	// Dereference
+	hz = x->hz;
+	symm = x->symm;
+	out = x->out;
+	samples = sampleframes;
+
+	bounce_inputs(x, ins, &bound_lo, &bound_hi, &lo_inc, &hi_inc);
+
+	//  outputs
+	for  (i = 0; i< x->voice_count; i++){
+		out[i] = (t_double *) (outs[i]);
+	}
+
+	// Loop through samples in vector performing audio calcs
+	while(samples--){
+		if(x->fm_run && x->fm_interval_run > 1){
+			bounce_fm_tick(x);
+		}
+		for(i = 0; i < x->bus_count; i++){
+			x->bus_loc[i] += x->bus_step[i];
+		}
+		bounce_step(x, bound_lo, bound_hi, 1, x->fm_interval_run > 1, (t_double) DCBLOCK_GAIN, rate, voicemode);
+
+		//store hz @ end of vector
+		for(i=0; i < x->voice_count; i++){
+			x->hzFloat[i] = *hz[i];
+		}
+		//increment pointers for next sample
+		bound_lo += lo_inc;
+		bound_hi += hi_inc;
+		for(i=0; i < x->voice_count; i++){
+			if(x->hz_conn[i]) hz[i]++;
+			if(x->symm_conn[i]) symm[i]++;
+			 out[i]++;
+		}
+	}
+}
+
+
+// "lfo" step size: the most samples (power of 2, up to LFO_MAXDEC) that still give the fastest
+// voice LFO_POINTS steps a bounce. A voice bounces at 2 * f0 / width Hz, so squeezed voices count
+// Not scaled with voice count: coupled voices' errors are first order in the step (collisions
+// land on step boundaries), so even 16x the points only gains ~25 dB at 0.1 Hz, and from 4 voices
+// at 2 Hz the output is a different signal at any step size, for most of the saving. See "bounce_bench lfo"
+static inline t_int bounce_lfo_dec(t_bounce *x)
+{
+	t_int dec;
+	for(dec = LFO_MAXDEC; dec > 1 && 2 * x->lfo_rate * dec * LFO_POINTS > x->srate; dec >>= 1);
+	return dec;
+}
+
+// "lfo": the ensemble moves lfo_dec samples at a time and each output ramps to where its voice
+// will be at the end of the step, with lfo_dec picked at every step from the rates at the last.
+// FM is worked out at every step. lfo_count carries across vectors; inputs are read at the
+// sample a step starts on, bus voices where their ramp is at its end (or the vector's, if the
+// step runs past it). Vectors where the voices are too fast to decimate run at full rate
+// with fullrate, steps use voicemode
+static inline void bounce_perform_lfo64(t_bounce *x, double **ins, double **outs, long sampleframes, t_bounce_voicecalc voicemode, t_bounce_voicecalc fullrate)
+{
+	t_double *bound_lo, *bound_hi, *out;
+	t_double val, inc;
+	t_int i, v, k, n, dec, lo_inc, hi_inc;
+
+	if(x->lfo_count == 0 && bounce_lfo_dec(x) == 1){
+		if(x->lfo_dec != 1){
+			x->lfo_dec = 1;
+			x->lfo_dcgain = DCBLOCK_GAIN;
+			x->fm_count = 0;		// control rate fm picks up from here
+		}
+		x->lfo_rate = 0;
+		bounce_perform64(x, ins, outs, sampleframes, &x->lfo_rate, fullrate);
+		for(v = 0; v < x->voice_count; v++){
+			x->lfo_val[v] = outs[v][sampleframes-1], x->lfo_step[v] = 0;
+		}
+		return;
+	}
+
+	bounce_inputs(x, ins, &bound_lo, &bound_hi, &lo_inc, &hi_inc);
+
+	for(i = 0; i < sampleframes; i += n){
+		if(x->lfo_count == 0){
+			dec = bounce_lfo_dec(x);
+			if(dec != x->lfo_dec){
+				x->lfo_dec = dec;
+				x->lfo_dcgain = pow(DCBLOCK_GAIN, dec);	// same cutoff at the step rate
+			}
+
+			for(v = 0; v < x->voice_count; v++){
+				x->out[v] = &x->lfo_next[v];
+			}
+			x->lfo_rate = 0;
+			bounce_bus_at(x, dec < sampleframes - i ? sampleframes - i - dec : 0);
+			bounce_step(x, bound_lo, bound_hi, dec, 0, x->lfo_dcgain, &x->lfo_rate, voicemode);
+			for(v = 0; v < x->voice_count; v++){
+				x->lfo_step[v] = (x->lfo_next[v] - x->lfo_val[v]) / dec;
+			}
+			x->lfo_count = dec;
+		}
+
+		n = x->lfo_count < sampleframes - i ? x->lfo_count : sampleframes - i;
+		x->lfo_count -= n;
+		for(v = 0; v < x->voice_count; v++){
+			out = outs[v] + i;
+			val = x->lfo_val[v];
+			inc = x->lfo_step[v];
+			for(k = 0; k < n; k++){
+				out[k] = val += inc;
+			}
+			// land exactly on the step's value
+			x->lfo_val[v] = x->lfo_count ? val : (out[n-1] = x->lfo_next[v]);
+		}
+
+		bound_lo += n * lo_inc;
+		bound_hi += n * hi_inc;
+		for(v = 0; v < x->voice_count; v++){
+			if(x->hz_conn[v]) x->hz[v] += n;
+			if(x->symm_conn[v]) x->symm[v] += n;
+		}
+	}
+
+	//store hz @ end of vector
+	for(v = 0; v < x->voice_count; v++){
+		x->hzFloat[v] = x->hz[v][x->hz_conn[v] ? -1 : 0];
+	}
+}
+
+
+// voice fades after "voices" / "mode" changes. Running voices are scaled by their gain,
+// switched-off voices fade from their last output and then stay silent
+static inline void bounce_fades(t_bounce *x, double **outs, long sampleframes)
+{
+	t_double g, target, held, inc;
+	t_double *out;
+	t_int i, v;
+
+	inc = x->fade_inc;
+	for(v = 0; v < x->voice_cap; v++){
+		out = outs[v];
+		g = x->gain[v];
+		target = x->gain_target[v];
+		if(v < x->voice_count){
+			x->last_out[v] = out[sampleframes-1];
+			if(g == target && g == 1){
+				continue;
+			}
+			for(i = 0; i < sampleframes; i++){
+				if(g < target) g = g + inc < target ? g + inc : target;
+				else if(g > target) g = g - inc > target ? g - inc : target;
+				out[i] *= g;
+			}
+		} else if(g > 0) {
+			held = x->last_out[v];
+			for(i = 0; i < sampleframes; i++){
+				g = g - inc > 0 ? g - inc : 0;
+				out[i] = held * g;
+			}
+		} else {
+			for(i = 0; i < sampleframes; i++){
+				out[i] = 0;
+			}
+		}
+		x->gain[v] = g;
+	}
+}
+
+
+// entry points - one per mode, voice calc passed as a constant so it inlines
+static void bounce_perform_shaper(t_bounce *x, double **ins, double **outs, long sampleframes)
+{
+	bounce_perform64(x, ins, outs, sampleframes, NULL, bounce_shaper_voicecalc);
+	bounce_fades(x, outs, sampleframes);
+}
+
+static void bounce_perform_ptr(t_bounce *x, double **ins, double **outs, long sampleframes)
+{
+	bounce_perform64(x, ins, outs, sampleframes, NULL, bounce_ptr_voicecalc);
+	bounce_fades(x, outs, sampleframes);
+}
+
+static void bounce_perform_plain(t_bounce *x, double **ins, double **outs, long sampleframes)
+{
+	bounce_perform64(x, ins, outs, sampleframes, NULL, bounce_plain_voicecalc);
+	bounce_fades(x, outs, sampleframes);
+}
+
+static void bounce_perform_lfo_shaper(t_bounce *x, double **ins, double **outs, long sampleframes)
+{
+	bounce_perform_lfo64(x, ins, outs, sampleframes, bounce_shaper_voicecalc, bounce_shaper_voicecalc);
+	bounce_fades(x, outs, sampleframes);
+}
+
+// PTR only at full rate: its transition region costs 2 * grad * t of travel per corner, which at
+// the step rate is a pitch error, and steps are only taken at rates that don't alias
+static void bounce_perform_lfo_ptr(t_bounce *x, double **ins, double **outs, long sampleframes)
+{
+	bounce_perform_lfo64(x, ins, outs, sampleframes, bounce_plain_voicecalc, bounce_ptr_voicecalc);
+	bounce_fades(x, outs, sampleframes);
+}
+
+static void bounce_perform_lfo_plain(t_bounce *x, double **ins, double **outs, long sampleframes)
+{
+	bounce_perform_lfo64(x, ins, outs, sampleframes, bounce_plain_voicecalc, bounce_plain_voicecalc);
+	bounce_fades(x, outs, sampleframes);
+}
+
+#endif
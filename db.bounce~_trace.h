@@ -0,0 +1,104 @@
+/*
+ *	db.bounce~_trace.h
+ *	AUTHOR:			Daniel Bennett
+ *	DESCRIPTION:	Input trace file format, written by db.bounce~'s "record" message
+ *					and read by the Linux replay tool (host/bounce_replay.c).
+ *
+ *					A trace is a t_trace_header followed by records, each a t_trace_rec
+ *					and then rec.size bytes of payload. Every payload starts with the
+ *					frame (samples since recording started) it belongs to - floats,
+ *					messages and dsp changes apply before the first block at or after
+ *					their frame, so the replay can hold them until then.
+ *
+ *					Native byte order and doubles: traces are replayed on the same kind
+ *					of machine they were made on.
+ */
+
+#ifndef DB_BOUNCE_TRACE_H
+#define DB_BOUNCE_TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC "DBBTRACE"
+#define TRACE_VERSION 7
+#define TRACE_MSGLEN 224		// longest message text recorded
+
+// object state at the first recorded vector, as doubles - see bounce_trace_state()
+#define TRACE_STATE_FIXED 26
+#define TRACE_STATE_PERVOICE 17
+#define TRACE_BUS_VOICES 10		// most voices on a bus (MAX_VOICES)
+#define TRACE_STATE_VALUES(cap) (TRACE_STATE_FIXED + TRACE_STATE_PERVOICE * (cap) + (cap) * (cap) \
+	+ TRACE_BUS_VOICES * (1 + (cap)))
+
+enum {
+	TRACE_STATE = 1,	// uint64 frame, then TRACE_STATE_VALUES(voice_cap) doubles
+	TRACE_DSP,			// t_trace_dsp, then numins connection flags (one byte each)
+	TRACE_FLOAT,		// t_trace_float
+	TRACE_MSG,			// uint64 frame, then the message as typed in a message box (no terminator)
+	TRACE_BLOCK,		// t_trace_block, then per connected inlet 1 double (constant) or frames doubles
+	TRACE_GAP,			// t_trace_gap - blocks lost to a full buffer, the replay can't follow past this
+	TRACE_BUS			// t_trace_bus, then count doubles - the "subscribe" bus as read for the next block
+};
+
+typedef struct _trace_header {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	voice_cap;
+	double		srate;
+} t_trace_header;
+
+typedef struct _trace_rec {
+	uint32_t	type;
+	uint32_t	size;			// payload bytes
+} t_trace_rec;
+
+typedef struct _trace_dsp {
+	uint64_t	frame;
+	double		srate;
+	uint32_t	vectorsize;
+	uint32_t	numins;
+} t_trace_dsp;
+
+typedef struct _trace_float {
+	uint64_t	frame;
+	uint32_t	inlet;
+	uint32_t	pad;
+	double		value;
+} t_trace_float;
+
+typedef struct _trace_block {
+	uint64_t	frame;
+	uint32_t	frames;
+	uint32_t	conn;			// bit per inlet: signal connected, data follows
+	uint32_t	constant;		// bit per inlet: whole block is one value, stored once
+	int32_t		gov_level;		// governor level the block ran at
+	uint64_t	checksum;		// bounce_trace_checksum() of the outputs
+	uint64_t	perform_ns;		// time the kernel took when recorded
+} t_trace_block;
+
+typedef struct _trace_bus {
+	uint64_t	frame;
+	uint32_t	count;			// voices on the bus
+	uint32_t	pad;
+} t_trace_bus;
+
+typedef struct _trace_gap {
+	uint64_t	frame;
+	uint64_t	frames;
+} t_trace_gap;
+
+// cheap hash of a block's output bits, to check a replay reproduces the recording exactly
+static inline uint64_t bounce_trace_checksum(double **outs, long numouts, long frames)
+{
+	uint64_t h = 1469598103934665603ULL, bits;
+	long v, i;
+	for(v = 0; v < numouts; v++){
+		for(i = 0; i < frames; i++){
+			memcpy(&bits, outs[v] + i, sizeof(bits));
+			h = ((h << 5) | (h >> 59)) ^ bits;
+		}
+	}
+	return h;
+}
+
+#endif
@@ -0,0 +1,615 @@
+/*
+ *	bench.c
+ *	DESCRIPTION:	Benchmarks for db.bounce~, run through the headless host.
+ *
+ *					bounce_bench fm [seconds] [voices] [mode]
+ *						CPU cost of control rate FM ("fmrate") against how far the
+ *						spectrum drifts from per-sample FM, on a dense fm matrix.
+ *
+ *					bounce_bench quality [--csv]
+ *						Aliasing and noise floor (FFT of a single voice at fixed bounds)
+ *						over a sweep of hz, symmetry and shape for mode 0 (naive + shaper)
+ *						and mode 1 (PTR), each with its ns/sample, then the ns/sample of
+ *						each mode by voice count, and the cheapest setting that meets a
+ *						few quality targets (points locked to an exact repeat left out).
+ *
+ *					bounce_bench lfo [seconds]
+ *						CPU saved by "lfo" (decimated ensemble, interpolated outputs) on
+ *						modulation-rate ensembles, and how far the outputs stray from the
+ *						full rate ones next to the drift a 1e-9 detune alone causes.
+ *
+ *					bounce_bench render <frames> "<args>" [message | inlet:value ...]
+ *						Renders one object (BENCH_SR, BENCH_VECTOR) with the given creation
+ *						args, messages and inlet floats, applied in order, and writes the
+ *						output to stdout as raw native doubles, interleaved by voice. The
+ *						reference for python/smoke.py.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "bounce_host.h"
+#include "spectrum.h"
+
+#define BENCH_SR 48000.
+#define BENCH_VECTOR 64
+#define BENCH_NFFT 8192
+#define BENCH_RUNS 3			// timing runs per row, best is reported
+#define BENCH_FLOOR_DB -90.		// bins below this (re: peak) don't count towards spectral deviation
+#define BENCH_MAXVOICES 10
+#define QUAL_NFFT 65536			// analysis length for the aliasing measurements
+#define QUAL_SKIP 4096			// settling samples before analysis
+#define QUAL_HARM_BINS 6		// bins either side of a harmonic (window main lobe + drift)
+#define QUAL_MAX_CENTS 10.		// pitch error still counted as meeting a target
+#define QUAL_FMAX 15000.		// db.bounce~ FMAX
+#define QUAL_LOCK_MAX 8192		// longest exact repeat (samples) looked for
+#define QUAL_LOCK_TOL 1e-9		// sample difference still counted as a repeat
+
+static double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double **bench_outs(long voices, long frames)
+{
+	double **outs = (double **) malloc(voices * sizeof(double *));
+	long v;
+	for(v = 0; v < voices; v++){
+		outs[v] = (double *) calloc(frames, sizeof(double));
+	}
+	return outs;
+}
+
+static void bench_free_outs(double **outs, long voices)
+{
+	long v;
+	for(v = 0; v < voices; v++){
+		free(outs[v]);
+	}
+	free(outs);
+}
+
+// best of BENCH_RUNS, in ns per sample frame (whole ensemble)
+static double bench_time(t_bounce_host *(*setup)(void *), void *arg, double **outs, long frames)
+{
+	t_bounce_host *h;
+	double start, t, best = -1;
+	int run;
+
+	for(run = 0; run < BENCH_RUNS; run++){
+		h = setup(arg);
+		start = bench_now();
+		bounce_host_render(h, NULL, outs, frames);
+		t = (bench_now() - start) / frames;
+		if(best < 0 || t < best) best = t;
+		bounce_host_free(h);
+	}
+	return best;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	FM CONTROL RATE		!!!!!!!!!!!!
+*************************************************************/
+
+typedef struct _fmbench {
+	long	voices;
+	long	mode;
+	long	interval;
+	long	interp;
+	double	detune;		// relative pitch offset, for the chaotic baseline
+} t_fmbench;
+
+// every voice modulates every other, alternating sign so the sums stay bounded
+static t_bounce_host *fm_setup(void *arg)
+{
+	t_fmbench *b = (t_fmbench *) arg;
+	t_bounce_host *h;
+	char msg[128];
+	long i, j;
+
+	snprintf(msg, sizeof(msg), "%ld -1. 1. %ld", b->voices, b->mode);
+	h = bounce_host_new(msg, BENCH_SR);
+	bounce_host_dsp(h, NULL, BENCH_VECTOR);
+	for(i = 0; i < b->voices; i++){
+		bounce_host_float(h, 2 + i, 60. * pow(1.45, i) * (1 + b->detune));
+		snprintf(msg, sizeof(msg), "shape %ld 0.6", i + 1);
+		bounce_host_send(h, msg);
+		for(j = 0; j < b->voices; j++){
+			if(i != j){
+				snprintf(msg, sizeof(msg), "fm %ld %ld %f", i + 1, j + 1, (i + j) % 2 ? -0.15 : 0.15);
+				bounce_host_send(h, msg);
+			}
+		}
+	}
+	snprintf(msg, sizeof(msg), "fmrate %ld", b->interval);
+	bounce_host_send(h, msg);
+	snprintf(msg, sizeof(msg), "fminterp %ld", b->interp);
+	bounce_host_send(h, msg);
+	return h;
+}
+
+static void fm_spectra(t_fmbench *b, double **outs, long frames, double **psd)
+{
+	t_bounce_host *h = fm_setup(b);
+	long v;
+	bounce_host_render(h, NULL, outs, frames);
+	bounce_host_free(h);
+	for(v = 0; v < b->voices; v++){
+		spec_welch(outs[v], frames, BENCH_NFFT, psd[v]);
+	}
+}
+
+static double fm_deviation(double **ref, double **psd, long voices)
+{
+	long v, lo = (long) (20. * BENCH_NFFT / BENCH_SR), hi = (long) (20000. * BENCH_NFFT / BENCH_SR);
+	double sum = 0;
+	for(v = 0; v < voices; v++){
+		sum += spec_logdist(ref[v], psd[v], lo, hi, BENCH_FLOOR_DB);
+	}
+	return sum / voices;
+}
+
+static int bench_fm(int argc, char **argv)
+{
+	static const long intervals[] = { 1, 2, 4, 8, 16, 32, 64 };
+	t_fmbench b = { 10, 0, 1, 1, 0 };
+	double seconds = 10, base, ns, **outs, *ref[BENCH_MAXVOICES], *psd[BENCH_MAXVOICES];
+	long frames, v, i;
+
+	if(argc > 0) seconds = atof(argv[0]);
+	if(argc > 1) b.voices = atol(argv[1]);
+	if(argc > 2) b.mode = atol(argv[2]);
+	if(b.voices < 1 || b.voices > BENCH_MAXVOICES || seconds <= 0){
+		fprintf(stderr, "bounce_bench fm: voices 1..%d, seconds > 0\n", BENCH_MAXVOICES);
+		return 1;
+	}
+	frames = (long) (seconds * BENCH_SR);
+	outs = bench_outs(b.voices, frames);
+	for(v = 0; v < b.voices; v++){
+		ref[v] = (double *) malloc((BENCH_NFFT / 2 + 1) * sizeof(double));
+		psd[v] = (double *) malloc((BENCH_NFFT / 2 + 1) * sizeof(double));
+	}
+
+	printf("db.bounce~ control rate FM: %ld voices, mode %ld, dense fm matrix, %.0f Hz, %.1f s\n", b.voices, b.mode, BENCH_SR, seconds);
+	printf("spectral deviation = RMS dB difference of per-voice Welch spectra vs fmrate 1, 20 Hz - 20 kHz\n\n");
+	printf("%8s %8s %11s %10s %16s\n", "fmrate", "fminterp", "ns/sample", "cpu saved", "deviation (dB)");
+
+	base = bench_time(fm_setup, &b, outs, frames);
+	fm_spectra(&b, outs, frames, ref);
+	printf("%8d %8s %11.1f %9.1f%% %16.2f\n", 1, "-", base, 0., 0.);
+
+	// the ensemble is chaotic: a 1e-9 detune already decorrelates it, so this is the floor
+	b.detune = 1e-9;
+	fm_spectra(&b, outs, frames, psd);
+	printf("%8s %8s %11s %10s %16.2f\n", "(chaos)", "-", "-", "-", fm_deviation(ref, psd, b.voices));
+	b.detune = 0;
+
+	for(i = 1; i < (long) (sizeof(intervals) / sizeof(intervals[0])); i++){
+		b.interval = intervals[i];
+		for(b.interp = 1; b.interp >= 0; b.interp--){
+			ns = bench_time(fm_setup, &b, outs, frames);
+			fm_spectra(&b, outs, frames, psd);
+			printf("%8ld %8ld %11.1f %9.1f%% %16.2f\n", b.interval, b.interp, ns, 100. * (base - ns) / base, fm_deviation(ref, psd, b.voices));
+		}
+	}
+
+	for(v = 0; v < b.voices; v++){
+		free(ref[v]), free(psd[v]);
+	}
+	bench_free_outs(outs, b.voices);
+	return 0;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	QUALITY PER CPU		!!!!!!!!!!!!
+*************************************************************/
+
+typedef struct _qualrun {
+	long	mode;
+	double	shape;		// mode 0 only, |shape| < 0.1 = naive triangle
+	double	symm;
+	double	hz;
+	long	voices;		// timing runs
+	long	fm;			// timing runs: dense fm matrix on
+} t_qualrun;
+
+typedef struct _qualresult {
+	double	f0;			// measured fundamental
+	double	cents;		// f0 re the requested hz (after the fmax clamp)
+	double	alias_db;	// non-harmonic energy re harmonic energy
+	double	floor_db;	// median non-harmonic bin re fundamental
+	long	lock;		// output repeats exactly every lock samples, 0 if it doesn't
+} t_qualresult;
+
+static t_bounce_host *qual_setup(void *arg)
+{
+	t_qualrun *q = (t_qualrun *) arg;
+	t_bounce_host *h;
+	char msg[128];
+	long i, j;
+
+	snprintf(msg, sizeof(msg), "%ld -1. 1. %ld", q->voices, q->mode);
+	h = bounce_host_new(msg, BENCH_SR);
+	bounce_host_dsp(h, NULL, BENCH_VECTOR);
+	for(i = 0; i < q->voices; i++){
+		bounce_host_float(h, 2 + i, q->voices > 1 ? 60. * pow(1.45, i) : q->hz);
+		bounce_host_float(h, 2 + q->voices + i, q->symm);
+		snprintf(msg, sizeof(msg), "shape %ld %f", i + 1, q->shape);
+		bounce_host_send(h, msg);
+		for(j = 0; q->fm && j < q->voices; j++){
+			if(i != j){
+				snprintf(msg, sizeof(msg), "fm %ld %ld %f", i + 1, j + 1, (i + j) % 2 ? -0.15 : 0.15);
+				bounce_host_send(h, msg);
+			}
+		}
+	}
+	return h;
+}
+
+static int qual_is_harmonic(long bin, double f0_bins)
+{
+	double k;
+	if(bin <= QUAL_HARM_BINS){
+		return 1;	// DC
+	}
+	k = floor(bin / f0_bins + 0.5);
+	return k >= 1 && fabs(bin - k * f0_bins) <= QUAL_HARM_BINS;
+}
+
+static int qual_cmp(const void *a, const void *b)
+{
+	double d = *(const double *) a - *(const double *) b;
+	return (d > 0) - (d < 0);
+}
+
+// shortest m the analysed output repeats itself after, 0 if none up to QUAL_LOCK_MAX. A locked
+// voice's spectrum is a few lines at multiples of BENCH_SR / m: at a whole number of samples per
+// period its aliases all land on harmonics, and either way there is no floor to measure
+static long qual_lock(const double *x, long n)
+{
+	long m, i;
+	for(m = 1; m <= QUAL_LOCK_MAX && m < n / 2; m++){
+		for(i = 0; i + m < n && fabs(x[i + m] - x[i]) <= QUAL_LOCK_TOL; i++);
+		if(i + m == n){
+			return m;
+		}
+	}
+	return 0;
+}
+
+// single voice at fixed bounds is periodic: everything off its harmonic series is aliasing
+static void qual_measure(t_qualrun *q, t_qualresult *r, double *buf, double *power, double *sorted)
+{
+	t_bounce_host *h;
+	double *outs[1], f0_bins, a, b, c, harm = 0, alias = 0;
+	long i, peak = QUAL_HARM_BINS + 1, n = 0;
+
+	q->voices = 1, q->fm = 0;
+	h = qual_setup(q);
+	outs[0] = buf;
+	bounce_host_render(h, NULL, outs, QUAL_SKIP + QUAL_NFFT);
+	bounce_host_free(h);
+	spec_power(buf + QUAL_SKIP, QUAL_NFFT, power);
+	r->lock = qual_lock(buf + QUAL_SKIP, QUAL_NFFT);
+
+	// fundamental = strongest bin, refined with a parabola through the log spectrum
+	for(i = peak; i < QUAL_NFFT / 2; i++){
+		if(power[i] > power[peak]) peak = i;
+	}
+	a = spec_db(power[peak-1]), b = spec_db(power[peak]), c = spec_db(power[peak+1]);
+	f0_bins = peak + 0.5 * (a - c) / (a - 2 * b + c);
+	r->f0 = f0_bins * BENCH_SR / QUAL_NFFT;
+	r->cents = 1200. * log2(r->f0 / (q->hz < QUAL_FMAX ? q->hz : QUAL_FMAX));
+
+	for(i = 0; i <= QUAL_NFFT / 2; i++){
+		if(qual_is_harmonic(i, f0_bins)){
+			if(i > QUAL_HARM_BINS) harm += power[i];
+		} else {
+			alias += power[i];
+			sorted[n++] = power[i];
+		}
+	}
+	qsort(sorted, n, sizeof(double), qual_cmp);
+	r->alias_db = spec_db(alias) - spec_db(harm);
+	r->floor_db = spec_db(sorted[n / 2]) - spec_db(power[peak]);
+}
+
+static int bench_quality(int argc, char **argv)
+{
+	// detuned off divisors of the sample rate, where aliases would land on harmonics and hide.
+	// 20k hits the fmax clamp
+	static const double hzs[] = { 110.3, 441.7, 1762.1, 3519.4, 7043.9, 11987.3, 14993.1, 20000 };
+	static const double symms[] = { 0.5, 0.8, 0.95 };
+	static const double shapes[] = { 0.05, 0.5, 1.0, -0.5 };	// mode 0: naive, sine, full sine, sinh
+	static const double targets[] = { -40, -60, -80 };
+	static const long voicecounts[] = { 1, 2, 4, 6, 8, 10 };
+	enum { NHZ = sizeof(hzs) / sizeof(hzs[0]), NSYMM = sizeof(symms) / sizeof(symms[0]),
+		NSHAPE = sizeof(shapes) / sizeof(shapes[0]), NCONF = NSHAPE + 1 };
+	t_qualrun q;
+	t_qualresult r;
+	double *buf, *power, *sorted, **outs;
+	double worst[NCONF][NHZ], cents[NCONF][NHZ], cost[NCONF][NHZ], t;
+	long locked[NCONF][NHZ];
+	char lock[16];
+	long conf, i, j, k, best, frames = (long) (2 * BENCH_SR);
+	int csv = argc > 0 && !strcmp(argv[0], "--csv");
+
+	buf = (double *) malloc((QUAL_SKIP + QUAL_NFFT) * sizeof(double));
+	power = (double *) malloc((QUAL_NFFT / 2 + 1) * sizeof(double));
+	sorted = (double *) malloc((QUAL_NFFT / 2 + 1) * sizeof(double));
+	outs = bench_outs(BENCH_MAXVOICES, frames);
+
+	// configurations: mode 0 with each shape, then mode 1 (shape has no effect)
+	if(!csv){
+		printf("db.bounce~ quality per CPU: 1 voice at fixed bounds -1..1, %.0f Hz, %d point Blackman-Harris FFT\n", BENCH_SR, QUAL_NFFT);
+		printf("alias = energy off the harmonic series re harmonic energy; floor = median off-harmonic bin re fundamental\n");
+		printf("cents = pitch error re requested hz. lock = output repeats exactly every this many samples: its\n");
+		printf("spectrum is a few fixed lines, and at a whole number of samples per period aliases fall on the\n");
+		printf("harmonics - they colour the timbre but are not counted, so alias and floor don't mean much there\n\n");
+		printf("%4s %6s %5s %8s %9s %7s %9s %9s %5s %9s\n", "mode", "shape", "symm", "hz", "f0", "cents", "alias dB", "floor dB", "lock", "ns/smp");
+	} else {
+		printf("mode,shape,symm,hz,f0,cents,alias_db,floor_db,lock,ns_per_sample\n");
+	}
+	for(conf = 0; conf < NCONF; conf++){
+		q.mode = conf < NSHAPE ? 0 : 1;
+		q.shape = conf < NSHAPE ? shapes[conf] : 0.05;
+		for(i = 0; i < NHZ; i++){
+			worst[conf][i] = -1000, cents[conf][i] = 0, cost[conf][i] = 0, locked[conf][i] = 0;
+			for(j = 0; j < NSYMM; j++){
+				// cost at this hz and symm - the PTR transitions and the shaper's work vary with both
+				q.hz = hzs[i], q.symm = symms[j], q.voices = 1, q.fm = 0;
+				t = bench_time(qual_setup, &q, outs, frames);
+				qual_measure(&q, &r, buf, power, sorted);
+				if(r.alias_db > worst[conf][i]) worst[conf][i] = r.alias_db;
+				if(fabs(r.cents) > cents[conf][i]) cents[conf][i] = fabs(r.cents);
+				if(t > cost[conf][i]) cost[conf][i] = t;
+				if(r.lock) locked[conf][i] = 1;
+				if(csv){
+					printf("%ld,%.2f,%.2f,%.1f,%.2f,%.1f,%.2f,%.2f,%ld,%.2f\n",
+						q.mode, q.shape, q.symm, q.hz, r.f0, r.cents, r.alias_db, r.floor_db, r.lock, t);
+				} else {
+					snprintf(lock, sizeof(lock), r.lock ? "%ld" : "-", r.lock);
+					printf("%4ld %6.2f %5.2f %8.0f %9.2f %7.1f %9.1f %9.1f %5s %9.1f\n",
+						q.mode, q.shape, q.symm, q.hz, r.f0, r.cents, r.alias_db, r.floor_db, lock, t);
+				}
+			}
+		}
+	}
+	if(csv){
+		goto done;
+	}
+
+	// cost by voice count
+	printf("\nns/sample by voice count (hz spread 60 Hz up, shape 0.6, symm 0.5)\n");
+	printf("%6s %11s %11s %11s %11s\n", "voices", "mode 0", "mode 1", "mode 0 fm", "mode 1 fm");
+	for(i = 0; i < (long) (sizeof(voicecounts) / sizeof(voicecounts[0])); i++){
+		printf("%6ld", voicecounts[i]);
+		for(k = 0; k < 4; k++){
+			q.voices = voicecounts[i], q.mode = k % 2, q.fm = k / 2, q.shape = 0.6, q.symm = 0.5, q.hz = 440;
+			printf(" %11.1f", bench_time(qual_setup, &q, outs, frames));
+		}
+		printf("\n");
+	}
+
+	// cheapest configuration whose worst case (over symmetry) meets each target, by its worst
+	// case cost over the same symmetries. A lock at any symmetry rules it out - its aliasing
+	// figure only holds at that exact pitch
+	printf("\ncheapest setting meeting an aliasing target within %.0f cents, not locked (worst case aliasing and cost over symm %.2f-%.2f)\n",
+		QUAL_MAX_CENTS, symms[0], symms[NSYMM-1]);
+	printf("%9s", "target");
+	for(i = 0; i < NHZ; i++){
+		printf(" %11.0f", hzs[i]);
+	}
+	printf("\n");
+	for(k = 0; k < (long) (sizeof(targets) / sizeof(targets[0])); k++){
+		printf("%6.0f dB", targets[k]);
+		for(i = 0; i < NHZ; i++){
+			best = -1;
+			for(conf = 0; conf < NCONF; conf++){
+				if(worst[conf][i] <= targets[k] && cents[conf][i] <= QUAL_MAX_CENTS && !locked[conf][i] && (best < 0 || cost[conf][i] < cost[best][i])) best = conf;
+			}
+			if(best < 0){
+				printf(" %11s", "-");
+			} else if(best < NSHAPE && fabs(shapes[best]) < 0.1){
+				printf(" %11s", "m0 naive");
+			} else if(best < NSHAPE){
+				printf("  m0 sh%5.2f", shapes[best]);
+			} else {
+				printf(" %11s", "m1 (ptr)");
+			}
+		}
+		printf("\n");
+	}
+done:
+	bench_free_outs(outs, BENCH_MAXVOICES);
+	free(buf), free(power), free(sorted);
+	return 0;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	LFO MODE		!!!!!!!!!!!!
+*************************************************************/
+
+typedef struct _lfobench {
+	long	voices;
+	long	mode;
+	long	lfo;
+	double	hz;			// fastest voice
+	long	fm;			// dense fm matrix on
+	double	detune;		// relative pitch offset, for the chaotic baseline
+} t_lfobench;
+
+// voices spread over the octave below hz, shaped, optionally all cross modulating
+static t_bounce_host *lfo_setup(void *arg)
+{
+	t_lfobench *b = (t_lfobench *) arg;
+	t_bounce_host *h;
+	char msg[128];
+	long i, j;
+
+	snprintf(msg, sizeof(msg), "%ld -1. 1. %ld", b->voices, b->mode);
+	h = bounce_host_new(msg, BENCH_SR);
+	bounce_host_dsp(h, NULL, BENCH_VECTOR);
+	for(i = 0; i < b->voices; i++){
+		bounce_host_float(h, 2 + i, b->hz * pow(0.5, (double) i / b->voices) * (1 + b->detune));
+		snprintf(msg, sizeof(msg), "shape %ld 0.6", i + 1);
+		bounce_host_send(h, msg);
+		for(j = 0; b->fm && j < b->voices; j++){
+			if(i != j){
+				snprintf(msg, sizeof(msg), "fm %ld %ld %f", i + 1, j + 1, (i + j) % 2 ? -0.15 : 0.15);
+				bounce_host_send(h, msg);
+			}
+		}
+	}
+	snprintf(msg, sizeof(msg), "lfo %ld", b->lfo);
+	bounce_host_send(h, msg);
+	return h;
+}
+
+// RMS difference between two renders over the second half, all voices, in dB re the first
+static double lfo_error(double **ref, double **outs, long voices, long frames)
+{
+	double err = 0, sig = 0, d;
+	long v, i;
+	for(v = 0; v < voices; v++){
+		for(i = frames / 2; i < frames; i++){
+			d = outs[v][i] - ref[v][i];
+			err += d * d;
+			sig += ref[v][i] * ref[v][i];
+		}
+	}
+	return spec_db(err / sig);
+}
+
+static int bench_lfo(int argc, char **argv)
+{
+	static const long voices[] = { 1, 4, 10 };
+	static const double hzs[] = { 0.1, 2, 20, 150 };
+	t_lfobench b;
+	double seconds = 10, base, ns, err, **outs, **ref;
+	t_bounce_host *h;
+	long frames, i, k;
+
+	if(argc > 0) seconds = atof(argv[0]);
+	if(seconds <= 0){
+		fprintf(stderr, "bounce_bench lfo: seconds > 0\n");
+		return 1;
+	}
+	frames = (long) (seconds * BENCH_SR);
+	outs = bench_outs(BENCH_MAXVOICES, frames);
+	ref = bench_outs(BENCH_MAXVOICES, frames);
+
+	printf("db.bounce~ \"lfo\": decimated ensemble against full rate, %.0f Hz, %.1f s\n", BENCH_SR, seconds);
+	printf("error = RMS difference from full rate over the second half, dB re signal. (chaos) is a full\n");
+	printf("rate run detuned by 1e-9 - error at that level is divergence, error near 0 dB above it is a\n");
+	printf("different signal\n\n");
+	printf("%6s %5s %8s %6s %12s %12s %8s %11s %11s\n", "voices", "mode", "top hz", "fm",
+		"full ns/smp", "lfo ns/smp", "speedup", "error (dB)", "(chaos)");
+	for(b.mode = 0; b.mode <= 1; b.mode++){
+		for(i = 0; i < (long) (sizeof(voices) / sizeof(voices[0])); i++){
+			for(k = 0; k < (long) (sizeof(hzs) / sizeof(hzs[0])); k++){
+				for(b.fm = 0; b.fm <= 1; b.fm++){
+					b.voices = voices[i], b.hz = hzs[k];
+					b.detune = 0;
+					b.lfo = 0;
+					base = bench_time(lfo_setup, &b, ref, frames);
+					b.lfo = 1;
+					ns = bench_time(lfo_setup, &b, outs, frames);
+					err = lfo_error(ref, outs, b.voices, frames);
+					b.lfo = 0;
+					b.detune = 1e-9;
+					h = lfo_setup(&b);
+					bounce_host_render(h, NULL, outs, frames);
+					bounce_host_free(h);
+					printf("%6ld %5ld %8.1f %6s %12.1f %12.1f %7.1fx %11.1f %11.1f\n", b.voices, b.mode, b.hz,
+						b.fm ? "dense" : "off", base, ns, base / ns, err, lfo_error(ref, outs, b.voices, frames));
+				}
+			}
+		}
+	}
+
+	bench_free_outs(outs, BENCH_MAXVOICES);
+	bench_free_outs(ref, BENCH_MAXVOICES);
+	return 0;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	RENDER		!!!!!!!!!!!!
+*************************************************************/
+
+static int bench_render(int argc, char **argv)
+{
+	t_bounce_host *h;
+	double **outs, *frame;
+	long frames, voices, i, v, inlet;
+	char *colon;
+
+	if(argc < 2 || (frames = atol(argv[0])) < 1){
+		fprintf(stderr, "usage: bounce_bench render <frames> \"<args>\" [message | inlet:value ...]\n");
+		return 1;
+	}
+	h = bounce_host_new(argv[1], BENCH_SR);
+	if(!h){
+		fprintf(stderr, "bounce_bench: could not create db.bounce~ %s\n", argv[1]);
+		return 1;
+	}
+	bounce_host_dsp(h, NULL, BENCH_VECTOR);
+	for(i = 2; i < argc; i++){
+		inlet = strtol(argv[i], &colon, 10);
+		if(colon != argv[i] && *colon == ':'){
+			bounce_host_float(h, inlet, atof(colon + 1));
+		} else if(bounce_host_send(h, argv[i]) != 0){
+			fprintf(stderr, "bounce_bench: db.bounce~ doesn't understand \"%s\"\n", argv[i]);
+			bounce_host_free(h);
+			return 1;
+		}
+	}
+
+	voices = bounce_host_numouts(h);
+	outs = bench_outs(voices, frames);
+	frame = (double *) malloc(voices * sizeof(double));
+	bounce_host_render(h, NULL, outs, frames);
+	for(i = 0; i < frames; i++){
+		for(v = 0; v < voices; v++){
+			frame[v] = outs[v][i];
+		}
+		fwrite(frame, sizeof(double), voices, stdout);
+	}
+	free(frame);
+	bench_free_outs(outs, voices);
+	bounce_host_free(h);
+	return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+	bounce_host_quiet(1);
+	bounce_host_init();
+
+	if(argc > 1 && !strcmp(argv[1], "fm")){
+		return bench_fm(argc - 2, argv + 2);
+	}
+	if(argc > 1 && !strcmp(argv[1], "quality")){
+		return bench_quality(argc - 2, argv + 2);
+	}
+	if(argc > 1 && !strcmp(argv[1], "lfo")){
+		return bench_lfo(argc - 2, argv + 2);
+	}
+	if(argc > 1 && !strcmp(argv[1], "render")){
+		return bench_render(argc - 2, argv + 2);
+	}
+	fprintf(stderr, "usage: bounce_bench fm [seconds] [voices] [mode]\n");
+	fprintf(stderr, "       bounce_bench quality [--csv]\n");
+	fprintf(stderr, "       bounce_bench lfo [seconds]\n");
+	fprintf(stderr, "       bounce_bench render <frames> \"<args>\" [message | inlet:value ...]\n");
+	return 1;
+}
@@ -0,0 +1,234 @@
+/*
+ *	bounce_host.c
+ *	DESCRIPTION:	Headless host for db.bounce~ - see bounce_host.h. db.bounce~.c is
+ *					compiled into this file (with its main() renamed) so the host can
+ *					reach the class and object internals.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "maxstub.h"
+
+#define main bounce_ext_main
+#include "../db.bounce~.c"
+#undef main
+
+#include "bounce_host.h"
+
+#define HOST_MAXATOMS 64
+#define HOST_MAXMSG 1024
+
+struct _bounce_host {
+	t_bounce		*x;
+	t_stub_dsp64	chain;
+	long			numins;
+	long			numouts;
+	long			vectorsize;
+	double			srate;
+	double			*silence;		// vectorsize zeros for NULL inputs
+};
+
+
+int bounce_host_init(void)
+{
+	if(!bounce_class){
+		bounce_ext_main();
+	}
+	return bounce_class ? 0 : -1;
+}
+
+void bounce_host_idle(void)
+{
+	stub_idle();
+}
+
+long bounce_host_governor(t_bounce_host *h, double *load)
+{
+	if(load){
+		*load = h->x->gov_load;
+	}
+	return h->x->gov_level;
+}
+
+int bounce_host_restore(t_bounce_host *h, const double *state, long n)
+{
+	double *copy;
+
+	if(n != TRACE_STATE_VALUES(h->x->voice_cap)){
+		return -1;
+	}
+	copy = (double *) malloc(n * sizeof(double));	// bounce_trace_state() isn't const
+	if(!copy){
+		return -1;
+	}
+	memcpy(copy, state, n * sizeof(double));
+	bounce_trace_state(h->x, copy, 0);
+	free(copy);
+	return 0;
+}
+
+void bounce_host_setlevel(t_bounce_host *h, long level)
+{
+	h->x->gov_on = 0;
+	h->x->gov_level = level < 0 ? 0 : level >= GOV_LEVELS ? GOV_LEVELS - 1 : level;
+}
+
+void bounce_host_busfeed(t_bounce_host *h, const double *loc, long n)
+{
+	t_bounce_bus *bus = __atomic_load_n(&h->x->bus_sub_req, __ATOMIC_ACQUIRE);
+
+	if(bus){
+		bounce_bus_write(bus, h->x->bus_block ? h->x->bus_block - 1 : 0, loc, n < MAX_VOICES ? n : MAX_VOICES);
+	}
+}
+
+void bounce_host_quiet(int quiet)
+{
+	stub_setquiet(quiet);
+}
+
+// split a box / message string into atoms. ints stay longs, other numbers are floats
+static short host_parse(char *str, t_atom *argv, short maxargs)
+{
+	char *tok, *save, *end;
+	double d;
+	short argc = 0;
+
+	for(tok = strtok_r(str, " \t\n", &save); tok && argc < maxargs; tok = strtok_r(NULL, " \t\n", &save)){
+		d = strtod(tok, &end);
+		if(end != tok && *end == '\0'){
+			if(strpbrk(tok, ".eE")){
+				atom_setfloat(argv + argc, d);
+			} else {
+				atom_setlong(argv + argc, (t_atom_long) d);
+			}
+		} else {
+			atom_setsym(argv + argc, gensym(tok));
+		}
+		argc++;
+	}
+	return argc;
+}
+
+t_bounce_host *bounce_host_new(const char *args, double srate)
+{
+	char buf[HOST_MAXMSG];
+	t_atom argv[HOST_MAXATOMS];
+	short argc = 0;
+	t_bounce_host *h;
+
+	if(bounce_host_init()){
+		return NULL;
+	}
+	if(args){
+		strncpy(buf, args, HOST_MAXMSG - 1);
+		buf[HOST_MAXMSG - 1] = '\0';
+		argc = host_parse(buf, argv, HOST_MAXATOMS);
+	}
+	h = (t_bounce_host *) calloc(1, sizeof(t_bounce_host));
+	h->srate = srate;
+	stub_setsr(srate);
+	h->x = (t_bounce *) bounce_new(gensym("db.bounce~"), argc, argv);
+	h->numins = h->x->obj.z_count;
+	h->numouts = h->x->voice_cap;
+	bounce_host_dsp(h, NULL, 64);
+	return h;
+}
+
+void bounce_host_free(t_bounce_host *h)
+{
+	bounce_dsp_free(h->x);
+	free(h->x);
+	free(h->silence);
+	free(h);
+}
+
+long bounce_host_numins(t_bounce_host *h)
+{
+	return h->numins;
+}
+
+long bounce_host_numouts(t_bounce_host *h)
+{
+	return h->numouts;
+}
+
+int bounce_host_send(t_bounce_host *h, const char *msg)
+{
+	char buf[HOST_MAXMSG];
+	t_atom argv[HOST_MAXATOMS];
+	short argc, type;
+	t_symbol *sel;
+	method m;
+
+	strncpy(buf, msg, HOST_MAXMSG - 1);
+	buf[HOST_MAXMSG - 1] = '\0';
+	argc = host_parse(buf, argv, HOST_MAXATOMS);
+	if(argc < 1){
+		return -1;
+	}
+	if(atom_gettype(argv) != A_SYM){	// bare number goes to the left inlet
+		bounce_host_float(h, 0, atom_getfloat(argv));
+		return 0;
+	}
+	sel = atom_getsym(argv);
+	m = class_findmethod(bounce_class, sel, &type);
+	if(!m){
+		return -1;
+	}
+	switch(type){
+		case A_GIMME:
+			((void (*)(t_bounce *, t_symbol *, short, t_atom *)) m)(h->x, sel, argc - 1, argv + 1);
+			return 0;
+		case A_FLOAT:
+			((void (*)(t_bounce *, double)) m)(h->x, argc > 1 ? atom_getfloat(argv + 1) : 0.);
+			return 0;
+		default:		// A_CANT - not for messages
+			return -1;
+	}
+}
+
+void bounce_host_float(t_bounce_host *h, long inlet, double f)
+{
+	h->x->obj.z_in = inlet;
+	bounce_float(h->x, f);
+	h->x->obj.z_in = 0;
+}
+
+void bounce_host_dsp(t_bounce_host *h, const short *connected, long vectorsize)
+{
+	short count[2 + 2 * MAX_VOICES];
+	long i;
+
+	for(i = 0; i < h->numins; i++){
+		count[i] = connected ? connected[i] : 0;
+	}
+	if(vectorsize != h->vectorsize){
+		free(h->silence);
+		h->silence = (double *) calloc(vectorsize, sizeof(double));
+		h->vectorsize = vectorsize;
+	}
+	bounce_dsp64(h->x, (t_object *) &h->chain, count, h->srate, vectorsize, 0);
+}
+
+void bounce_host_perform(t_bounce_host *h, double **ins, double **outs, long frames)
+{
+	h->chain.d_perform(h->x, (t_object *) &h->chain, ins, h->numins, outs, h->numouts, frames, h->chain.d_flags, h->chain.d_userparam);
+}
+
+void bounce_host_render(t_bounce_host *h, double **ins, double **outs, long frames)
+{
+	double *vins[2 + 2 * MAX_VOICES], *vouts[MAX_VOICES];
+	long i, pos, n;
+
+	for(pos = 0; pos < frames; pos += n){
+		n = frames - pos < h->vectorsize ? frames - pos : h->vectorsize;
+		for(i = 0; i < h->numins; i++){
+			vins[i] = (ins && ins[i]) ? ins[i] + pos : h->silence;
+		}
+		for(i = 0; i < h->numouts; i++){
+			vouts[i] = outs[i] + pos;
+		}
+		bounce_host_perform(h, vins, vouts, n);
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ *	bounce_host.h
+ *	DESCRIPTION:	Headless host for db.bounce~ on Linux. Builds db.bounce~.c against
+ *					the Max API stub (maxstub/) and drives real objects - creation
+ *					args, messages by name, dsp64 and perform - so the exact code that
+ *					runs in Max can be benchmarked, replayed and scripted.
+ *
+ *					Objects are independent: once bounce_host_init() has run, separate
+ *					objects can be rendered from separate threads. Buses ("publish" /
+ *					"subscribe") are shared by every object in the process, and safe to
+ *					use across those threads.
+ */
+
+#ifndef BOUNCE_HOST_H
+#define BOUNCE_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _bounce_host t_bounce_host;
+
+// register the class (runs db.bounce~'s main()) - call once before anything else
+int		bounce_host_init(void);
+
+// args as typed in the object box, e.g. "3 -1 1 1" - NULL for defaults
+t_bounce_host	*bounce_host_new(const char *args, double srate);
+void	bounce_host_free(t_bounce_host *h);
+
+long	bounce_host_numins(t_bounce_host *h);		// 2 + 2 * voice capacity
+long	bounce_host_numouts(t_bounce_host *h);		// voice capacity
+
+// message as typed in a message box, e.g. "fm 1 2 0.5" - returns -1 if not understood
+int		bounce_host_send(t_bounce_host *h, const char *msg);
+// float to a given inlet (0 lo bound, 1 hi bound, then hz per voice, then symm per voice)
+void	bounce_host_float(t_bounce_host *h, long inlet, double f);
+
+// (re)build the dsp chain. connected[i] != 0 marks inlet i as a signal (NULL = none)
+void	bounce_host_dsp(t_bounce_host *h, const short *connected, long vectorsize);
+
+// one perform call, exactly as Max makes it. ins: numins vectors, outs: numouts vectors
+void	bounce_host_perform(t_bounce_host *h, double **ins, double **outs, long frames);
+// any number of frames, split into vectorsize perform calls. NULL ins (unconnected inlets only) read as silence
+void	bounce_host_render(t_bounce_host *h, double **ins, double **outs, long frames);
+
+// run anything objects deferred to the main thread (qelems - e.g. governor reports)
+void	bounce_host_idle(void);
+
+// CPU governor level (0 = full quality) and smoothed load (share of vector duration)
+long	bounce_host_governor(t_bounce_host *h, double *load);
+
+// replay support (bounce_replay): put the object in the state a trace starts from -
+// TRACE_STATE_VALUES(capacity) doubles, see db.bounce~_trace.h. Returns -1 on a size mismatch
+int		bounce_host_restore(t_bounce_host *h, const double *state, long n);
+// governor off, quality level fixed (as recorded per block)
+void	bounce_host_setlevel(t_bounce_host *h, long level);
+// positions onto the bus the object subscribes to, as its publisher would - read by the next perform
+void	bounce_host_busfeed(t_bounce_host *h, const double *loc, long n);
+
+// silence post() (class banner, messages)
+void	bounce_host_quiet(int quiet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ *	check.c
+ *	DESCRIPTION:	Regression checks for db.bounce~'s live reconfiguration, run with
+ *					"make -C host check".
+ *
+ *					bounce_check
+ *
+ *					governor: records a trace while "governor 0" takes the object from a
+ *					reduced quality level back to full mid-stream, then replays it with
+ *					bounce_replay (from the same directory), which must match bit for bit.
+ *
+ *					voices: "voices" changes on a shaped ensemble. Voices that keep running
+ *					through the change must step no further from one sample to the next
+ *					than they do in normal running.
+ *
+ *					Exits non-zero if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bounce_host.h"
+
+#define CHECK_SR 48000.
+#define CHECK_VECTOR 64
+#define CHECK_MAXVOICES 10
+
+static char check_dir[1024];		// where bounce_check (and bounce_replay) live
+
+static int check_fail(const char *check, const char *what)
+{
+	printf("check %s: FAIL - %s\n", check, what);
+	return 1;
+}
+
+static t_bounce_host *check_new(const char *args, const char **steps)
+{
+	t_bounce_host *h = bounce_host_new(args, CHECK_SR);
+	char *colon;
+	long inlet;
+
+	if(!h){
+		return NULL;
+	}
+	bounce_host_dsp(h, NULL, CHECK_VECTOR);
+	for(; steps && *steps; steps++){
+		inlet = strtol(*steps, &colon, 10);
+		if(colon != *steps && *colon == ':'){
+			bounce_host_float(h, inlet, atof(colon + 1));
+		} else {
+			bounce_host_send(h, *steps);
+		}
+	}
+	return h;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	GOVERNOR		!!!!!!!!!!!!
+*************************************************************/
+
+// the level "governor 0" asks for is taken by the audio thread, inside a recorded vector
+static int check_governor(void)
+{
+	static const char *steps[] = { "2:110", "3:165.5", "4:220", "5:87", "6:310", "7:47",
+		"fm 1 2 0.3", "fm 2 3 -0.2", "fm 3 4 0.25", "fm 4 5 -0.15", "fm 5 6 0.2", "fm 6 1 -0.3",
+		"fmrate 16", NULL };
+	double o[CHECK_MAXVOICES][CHECK_VECTOR], *outs[CHECK_MAXVOICES];
+	char path[] = "/tmp/bounce_check_XXXXXX", msg[1100], cmd[2200];
+	t_bounce_host *h;
+	long i;
+	int fd, status;
+
+	for(i = 0; i < CHECK_MAXVOICES; i++){
+		outs[i] = o[i];
+	}
+	if((fd = mkstemp(path)) < 0){
+		return check_fail("governor", "can't make a temporary trace file");
+	}
+	close(fd);
+	h = check_new("6 -1. 1. 0", steps);
+	bounce_host_setlevel(h, 3);		// where a governor under load leaves it
+	for(i = 0; i < 100; i++){
+		bounce_host_perform(h, NULL, outs, CHECK_VECTOR);
+	}
+	snprintf(msg, sizeof(msg), "record %s", path);
+	bounce_host_send(h, msg);
+	for(i = 0; i < 400; i++){
+		if(i == 200){
+			bounce_host_send(h, "governor 0");
+		}
+		bounce_host_perform(h, NULL, outs, CHECK_VECTOR);
+		bounce_host_idle();
+	}
+	bounce_host_send(h, "record");
+	bounce_host_idle();
+	if(bounce_host_governor(h, NULL) != 0){
+		bounce_host_free(h);
+		unlink(path);
+		return check_fail("governor", "\"governor 0\" didn't go back to level 0");
+	}
+	bounce_host_free(h);
+
+	snprintf(cmd, sizeof(cmd), "%s/bounce_replay %s --top 0 > /dev/null", check_dir, path);
+	status = system(cmd);
+	unlink(path);
+	if(status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+		return check_fail("governor", "replay of \"governor 0\" mid-stream differs from the recording");
+	}
+	printf("check governor: ok - \"governor 0\" mid-stream replays bit for bit\n");
+	return 0;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	VOICES		!!!!!!!!!!!!
+*************************************************************/
+
+// largest sample to sample step of voices first ... last over the next frames
+static double check_steps(t_bounce_host *h, long first, long last, long frames, double *prev)
+{
+	double o[CHECK_MAXVOICES][CHECK_VECTOR], *outs[CHECK_MAXVOICES], d, step = 0;
+	long i, v, n;
+
+	for(i = 0; i < CHECK_MAXVOICES; i++){
+		outs[i] = o[i];
+	}
+	for(n = 0; n < frames; n += CHECK_VECTOR){
+		bounce_host_perform(h, NULL, outs, CHECK_VECTOR);
+		for(v = first; v <= last; v++){
+			for(i = 0; i < CHECK_VECTOR; i++){
+				d = o[v][i] - prev[v];
+				step = d > step ? d : -d > step ? -d : step;
+				prev[v] = o[v][i];
+			}
+		}
+	}
+	return step;
+}
+
+// voices running on either side of the change (they change neighbours), over the fade out and
+// back in, against normal running before and after
+static int check_voices(void)
+{
+	static const char *steps[] = { "2:110", "3:165.5", "4:220",
+		"shape 1 0.8", "shape 2 0.8", "shape 3 0.8", NULL };
+	static const struct { const char *msg; long first, last; } changes[] = {
+		{ "voices 2", 0, 1 }, { "voices 3", 0, 1 }, { "voices 1", 0, 0 }, { "voices 3", 0, 0 } };
+	double prev[CHECK_MAXVOICES] = { 0 }, normal, after, change;
+	char what[256];
+	t_bounce_host *h = check_new("3 -1. 1. 0", steps);
+	long i, frames = (long) (0.5 * CHECK_SR), fade = (long) (0.025 * CHECK_SR);
+	int failed = 0;
+
+	check_steps(h, 0, 2, CHECK_VECTOR, prev);
+	for(i = 0; i < (long) (sizeof(changes) / sizeof(changes[0])); i++){
+		normal = check_steps(h, changes[i].first, changes[i].last, frames, prev);
+		bounce_host_send(h, changes[i].msg);
+		change = check_steps(h, changes[i].first, changes[i].last, fade, prev);
+		after = check_steps(h, changes[i].first, changes[i].last, frames, prev);
+		normal = after > normal ? after : normal;
+		if(change > normal){
+			snprintf(what, sizeof(what), "\"%s\": voices %ld-%ld step %.4f, against %.4f running", changes[i].msg,
+				changes[i].first + 1, changes[i].last + 1, change, normal);
+			failed |= check_fail("voices", what);
+		}
+	}
+	bounce_host_free(h);
+	if(!failed){
+		printf("check voices: ok - no steps in voices running through \"voices\" changes\n");
+	}
+	return failed;
+}
+
+
+int main(int argc, char **argv)
+{
+	const char *slash = strrchr(argv[0], '/');
+	int failed = 0;
+
+	if(slash){
+		snprintf(check_dir, sizeof(check_dir), "%.*s", (int) (slash - argv[0]), argv[0]);
+	} else {
+		snprintf(check_dir, sizeof(check_dir), ".");
+	}
+	bounce_host_quiet(1);
+	bounce_host_init();
+
+	failed += check_governor();
+	failed += check_voices();
+	return failed != 0;
+}
@@ -0,0 +1,312 @@
+/*
+ *	maxstub.c
+ *	DESCRIPTION:	Headless implementation of the Max API subset declared in
+ *					maxstub/ext.h. Just enough to create db.bounce~ objects, send
+ *					them messages by name and call their perform routine from a
+ *					Linux process. Not thread-safe for class setup or gensym - do
+ *					both before starting any render threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "maxstub/ext.h"
+#include "maxstub.h"
+
+static t_symbol *stub_symbols;	// interned symbols (never freed)
+static double stub_srate = 44100.;
+static int stub_quiet;
+
+typedef struct _qelem {
+	void			*q_obj;
+	method			q_fn;
+	volatile int	q_set;		// set from any thread, no locks
+	struct _qelem	*q_next;
+} t_stub_qelem;
+
+static t_stub_qelem *stub_qelems;	// live qelems, checked by stub_idle()
+
+
+/************************************************************
+!!!!!!!!!!!!	CLASSES & OBJECTS		!!!!!!!!!!!!
+*************************************************************/
+
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...)
+{
+	t_class *c = (t_class *) calloc(1, sizeof(t_class));
+	c->c_name = gensym(name);
+	c->c_new = mnew;
+	c->c_free = mfree;
+	c->c_size = size;
+	return c;
+}
+
+long class_addmethod(t_class *c, method m, const char *name, ...)
+{
+	va_list args;
+	int type;
+
+	if(c->c_nmethods >= STUB_MAX_METHODS){
+		return 1;
+	}
+	c->c_methods[c->c_nmethods].m_sym = gensym(name);
+	c->c_methods[c->c_nmethods].m_fun = m;
+	va_start(args, name);
+	type = va_arg(args, int);
+	va_end(args);
+	c->c_methods[c->c_nmethods].m_type = type;
+	c->c_nmethods++;
+	return 0;
+}
+
+long class_register(t_symbol *name_space, t_class *c)
+{
+	return 0;
+}
+
+void class_dspinit(t_class *c)
+{
+}
+
+void *object_alloc(t_class *c)
+{
+	t_object *x = (t_object *) calloc(1, c->c_size);
+	if(x){
+		x->o_class = c;
+	}
+	return x;
+}
+
+// only "dsp_add64" is understood: (object, perform routine, flags, userparam)
+void *object_method(void *x, t_symbol *s, ...)
+{
+	va_list args;
+	t_stub_dsp64 *chain = (t_stub_dsp64 *) x;
+
+	if(s == gensym("dsp_add64")){
+		va_start(args, s);
+		chain->d_obj = va_arg(args, void *);
+		chain->d_perform = va_arg(args, t_stub_perform64);
+		chain->d_flags = va_arg(args, long);
+		chain->d_userparam = va_arg(args, void *);
+		va_end(args);
+	}
+	return NULL;
+}
+
+method class_findmethod(t_class *c, t_symbol *s, short *type)
+{
+	int i;
+	for(i = 0; i < c->c_nmethods; i++){
+		if(c->c_methods[i].m_sym == s){
+			if(type) *type = c->c_methods[i].m_type;
+			return c->c_methods[i].m_fun;
+		}
+	}
+	return NULL;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	MSP			!!!!!!!!!!!!
+*************************************************************/
+
+void dsp_setup(t_pxobject *x, long nsignals)
+{
+	x->z_count = (short) nsignals;
+}
+
+void dsp_free(t_pxobject *x)
+{
+}
+
+void *outlet_new(void *x, const char *type)
+{
+	return (void *) ++((t_object *) x)->o_outlets;
+}
+
+double sys_getsr(void)
+{
+	return stub_srate;
+}
+
+void stub_setsr(double sr)
+{
+	stub_srate = sr;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	QELEMS		!!!!!!!!!!!!
+*************************************************************/
+
+void *qelem_new(void *obj, method fn)
+{
+	t_stub_qelem *q = (t_stub_qelem *) calloc(1, sizeof(t_stub_qelem));
+	q->q_obj = obj;
+	q->q_fn = fn;
+	q->q_next = stub_qelems;
+	stub_qelems = q;
+	return q;
+}
+
+void qelem_set(void *q)
+{
+	__atomic_store_n(&((t_stub_qelem *) q)->q_set, 1, __ATOMIC_RELEASE);
+}
+
+void qelem_unset(void *q)
+{
+	__atomic_store_n(&((t_stub_qelem *) q)->q_set, 0, __ATOMIC_RELEASE);
+}
+
+void qelem_free(void *q)
+{
+	t_stub_qelem **p;
+	for(p = &stub_qelems; *p; p = &(*p)->q_next){
+		if(*p == q){
+			*p = ((t_stub_qelem *) q)->q_next;
+			free(q);
+			return;
+		}
+	}
+}
+
+void *defer_low(void *ob, method fn, t_symbol *s, short argc, t_atom *argv)
+{
+	((void (*)(void *, t_symbol *, short, t_atom *)) fn)(ob, s, argc, argv);
+	return NULL;
+}
+
+// run every qelem that has been set since the last call
+void stub_idle(void)
+{
+	t_stub_qelem *q;
+	for(q = stub_qelems; q; q = q->q_next){
+		if(__atomic_exchange_n(&q->q_set, 0, __ATOMIC_ACQ_REL)){
+			q->q_fn(q->q_obj);
+		}
+	}
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	MEMORY, SYMBOLS, CONSOLE		!!!!!!!!!!!!
+*************************************************************/
+
+char *t_getbytes(long size)
+{
+	return (char *) calloc(1, size);
+}
+
+void t_freebytes(void *b, long size)
+{
+	free(b);
+}
+
+void stub_setquiet(int quiet)
+{
+	stub_quiet = quiet;
+}
+
+t_symbol *gensym(const char *s)
+{
+	t_symbol *sym;
+	for(sym = stub_symbols; sym; sym = sym->s_next){
+		if(!strcmp(sym->s_name, s)){
+			return sym;
+		}
+	}
+	sym = (t_symbol *) calloc(1, sizeof(t_symbol));
+	sym->s_name = (char *) malloc(strlen(s) + 1);
+	strcpy(sym->s_name, s);
+	sym->s_next = stub_symbols;
+	stub_symbols = sym;
+	return sym;
+}
+
+void post(const char *fmt, ...)
+{
+	va_list args;
+	if(stub_quiet){
+		return;
+	}
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	ATOMS		!!!!!!!!!!!!
+*************************************************************/
+
+long atom_gettype(const t_atom *a)
+{
+	return a->a_type;
+}
+
+t_atom_long atom_getlong(const t_atom *a)
+{
+	switch(a->a_type){
+		case A_LONG: return a->a_w.w_long;
+		case A_FLOAT: return (t_atom_long) a->a_w.w_float;
+		default: return 0;
+	}
+}
+
+double atom_getfloat(const t_atom *a)
+{
+	switch(a->a_type){
+		case A_LONG: return (double) a->a_w.w_long;
+		case A_FLOAT: return a->a_w.w_float;
+		default: return 0.;
+	}
+}
+
+t_symbol *atom_getsym(const t_atom *a)
+{
+	return a->a_type == A_SYM ? a->a_w.w_sym : gensym("");
+}
+
+long atom_getintarg(short which, short argc, t_atom *argv)
+{
+	return which < argc ? (long) atom_getlong(argv + which) : 0;
+}
+
+long atom_arg_getlong(t_atom_long *c, long idx, long ac, t_atom *av)
+{
+	if(idx < ac && (av[idx].a_type == A_LONG || av[idx].a_type == A_FLOAT)){
+		*c = atom_getlong(av + idx);
+		return 0;
+	}
+	return 1;
+}
+
+long atom_arg_getdouble(double *c, long idx, long ac, t_atom *av)
+{
+	if(idx < ac && (av[idx].a_type == A_LONG || av[idx].a_type == A_FLOAT)){
+		*c = atom_getfloat(av + idx);
+		return 0;
+	}
+	return 1;
+}
+
+long atom_setlong(t_atom *a, t_atom_long b)
+{
+	a->a_type = A_LONG, a->a_w.w_long = b;
+	return 0;
+}
+
+long atom_setfloat(t_atom *a, double b)
+{
+	a->a_type = A_FLOAT, a->a_w.w_float = b;
+	return 0;
+}
+
+long atom_setsym(t_atom *a, t_symbol *s)
+{
+	a->a_type = A_SYM, a->a_w.w_sym = s;
+	return 0;
+}
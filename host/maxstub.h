@@ -0,0 +1,45 @@
+/*
+ *	maxstub.h
+ *	DESCRIPTION:	Host-side view of the headless Max API (maxstub.c): the class
+ *					and dsp chain structs the real SDK keeps private.
+ */
+
+#ifndef DB_MAXSTUB_H
+#define DB_MAXSTUB_H
+
+#include "maxstub/ext.h"
+
+#define STUB_MAX_METHODS 64
+
+typedef void (*t_stub_perform64)(void *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+
+typedef struct _stub_method {
+	t_symbol	*m_sym;
+	method		m_fun;
+	int			m_type;		// A_GIMME, A_FLOAT, A_CANT...
+} t_stub_method;
+
+struct _class {
+	t_symbol		*c_name;
+	method			c_new;
+	method			c_free;
+	long			c_size;
+	t_stub_method	c_methods[STUB_MAX_METHODS];
+	int				c_nmethods;
+};
+
+// what an object's dsp64 method registers via object_method(dsp64, "dsp_add64", ...)
+typedef struct _stub_dsp64 {
+	t_object			d_ob;
+	void				*d_obj;
+	t_stub_perform64	d_perform;
+	long				d_flags;
+	void				*d_userparam;
+} t_stub_dsp64;
+
+method	class_findmethod(t_class *c, t_symbol *s, short *type);
+void	stub_setsr(double sr);
+void	stub_setquiet(int quiet);
+void	stub_idle(void);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ *	ext.h (headless host)
+ *	DESCRIPTION:	The subset of the Max/MSP API that db.bounce~ uses, so the object
+ *					can be built and driven on Linux without Max (benchmarks, replay,
+ *					Python bindings). Implemented in host/maxstub.c - the real SDK
+ *					headers are used for the Max builds.
+ */
+
+#ifndef DB_MAXSTUB_EXT_H
+#define DB_MAXSTUB_EXT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define C74_EXPORT
+#ifndef PI
+	#define PI 3.14159265358979323846
+#endif
+
+typedef intptr_t	t_ptr_int;
+typedef t_ptr_int	t_int;
+typedef t_ptr_int	t_atom_long;
+typedef double		t_double;
+typedef unsigned char	t_bool;
+typedef void *(*method)(void *, ...);
+
+typedef struct _symbol {
+	char	*s_name;
+	struct _symbol *s_next;		// intern list
+} t_symbol;
+
+enum { A_NOTHING = 0, A_LONG, A_FLOAT, A_SYM, A_GIMME = 8, A_CANT = 9 };
+
+typedef struct _atom {
+	short	a_type;
+	union {
+		t_atom_long	w_long;
+		double		w_float;
+		t_symbol	*w_sym;
+	} a_w;
+} t_atom;
+
+typedef struct _class t_class;
+
+typedef struct _object {
+	t_class	*o_class;
+	long	o_outlets;		// outlets created with outlet_new
+} t_object;
+
+typedef struct _pxobject {
+	t_object	z_ob;
+	long		z_in;		// inlet the current message arrived at
+	void		*z_proxy;
+	long		z_disabled;
+	short		z_count;	// signal inlets (dsp_setup)
+	short		z_misc;
+} t_pxobject;
+
+#define Z_NO_INPLACE	1
+#define ASSIST_INLET	1
+#define ASSIST_OUTLET	2
+#define CLASS_BOX		gensym("box")
+
+t_class	*class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...);
+long	class_addmethod(t_class *c, method m, const char *name, ...);
+long	class_register(t_symbol *name_space, t_class *c);
+void	class_dspinit(t_class *c);
+void	*object_alloc(t_class *c);
+void	*object_method(void *x, t_symbol *s, ...);
+
+void	dsp_setup(t_pxobject *x, long nsignals);
+void	dsp_free(t_pxobject *x);
+void	*outlet_new(void *x, const char *type);
+double	sys_getsr(void);
+
+char	*t_getbytes(long size);
+void	t_freebytes(void *b, long size);
+
+// qelems run on the "main thread" - whenever the host calls stub_idle()
+void	*qelem_new(void *obj, method fn);
+void	qelem_set(void *q);
+void	qelem_unset(void *q);
+void	qelem_free(void *q);
+// the host is its own main thread - deferred calls run straight away
+void	*defer_low(void *ob, method fn, t_symbol *s, short argc, t_atom *argv);
+
+t_symbol	*gensym(const char *s);
+void	post(const char *fmt, ...);
+
+long		atom_gettype(const t_atom *a);
+t_atom_long	atom_getlong(const t_atom *a);
+double		atom_getfloat(const t_atom *a);
+t_symbol	*atom_getsym(const t_atom *a);
+long		atom_getintarg(short which, short argc, t_atom *argv);
+long		atom_arg_getlong(t_atom_long *c, long idx, long ac, t_atom *av);
+long		atom_arg_getdouble(double *c, long idx, long ac, t_atom *av);
+long		atom_setlong(t_atom *a, t_atom_long b);
+long		atom_setfloat(t_atom *a, double b);
+long		atom_setsym(t_atom *a, t_symbol *s);
+
+#endif
@@ -0,0 +1,2 @@
+/* z_dsp.h (headless host) - everything db.bounce~ needs is declared in ext.h */
+#include "ext.h"
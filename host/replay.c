@@ -0,0 +1,387 @@
+/*
+ *	replay.c
+ *	DESCRIPTION:	Replays an input trace made with db.bounce~'s "record" message through
+ *					the same DSP code, to profile it and reproduce CPU spikes exactly.
+ *
+ *					bounce_replay <trace> [--repeat N] [--top N] [--out file]
+ *
+ *					The object starts from the recorded state. Floats, messages and dsp
+ *					changes are applied before the vector they were recorded against,
+ *					what it read from a "subscribe" bus goes back onto the bus for it,
+ *					each vector runs at the governor level it ran at live, and its output
+ *					is checked against the recorded checksum. Reports perform time per
+ *					vector (best of --repeat passes) next to the recorded time, and the
+ *					slowest vectors. --out writes the output as raw native doubles,
+ *					interleaved by voice. Exits 2 if the output differs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "bounce_host.h"
+#include "db.bounce~_trace.h"
+
+#define REPLAY_MAXINS 22		// 2 + 2 * MAX_VOICES
+#define REPLAY_TOP 10
+
+typedef struct _pending {
+	uint32_t	type;
+	uint32_t	size;
+	char		*payload;		// starts with the frame it applies from
+} t_pending;
+
+typedef struct _blockstat {
+	uint64_t	frame;
+	uint32_t	frames;
+	uint32_t	events;			// floats / messages / dsp changes applied just before it
+	double		ns;				// best replay time
+	double		rec_ns;			// time when recorded
+} t_blockstat;
+
+typedef struct _replay {
+	const char	*path;
+	FILE		*out;			// --out
+	t_trace_header hdr;
+	t_blockstat	*blocks;
+	long		nblocks;
+	long		maxblocks;
+	long		nmsgs, nfloats, ndsp;
+	uint64_t	frames;
+	uint64_t	gap_frame;		// first gap, UINT64_MAX if none
+	long		mismatch;		// first block whose output differs, -1 if none
+} t_replay;
+
+static double replay_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void replay_apply(t_bounce_host *h, t_pending *p)
+{
+	t_trace_float f;
+	t_trace_dsp d;
+	short conn[REPLAY_MAXINS];
+	char text[TRACE_MSGLEN + 1];
+	uint32_t i, n;
+
+	switch(p->type){
+		case TRACE_FLOAT:
+			memcpy(&f, p->payload, sizeof(f));
+			bounce_host_float(h, f.inlet, f.value);
+			break;
+		case TRACE_MSG:
+			n = p->size - sizeof(uint64_t) < TRACE_MSGLEN ? p->size - sizeof(uint64_t) : TRACE_MSGLEN;
+			memcpy(text, p->payload + sizeof(uint64_t), n);
+			text[n] = '\0';
+			bounce_host_send(h, text);
+			break;
+		case TRACE_DSP:
+			memcpy(&d, p->payload, sizeof(d));
+			for(i = 0; i < d.numins && i < REPLAY_MAXINS; i++){
+				conn[i] = p->payload[sizeof(d) + i];
+			}
+			bounce_host_dsp(h, conn, d.vectorsize);
+			break;
+	}
+}
+
+// one pass through the trace. Pass 0 fills in the block list, later passes keep the best times
+static int replay_pass(t_replay *r, int pass)
+{
+	FILE *fp;
+	t_trace_header hdr;
+	t_trace_rec rec;
+	t_trace_block blk;
+	t_bounce_host *h = NULL;
+	t_pending *pending = NULL;
+	double *ins[REPLAY_MAXINS], *outs[REPLAY_MAXINS], *state = NULL, *silence = NULL, start, ns;
+	double bus[TRACE_BUS_VOICES];
+	t_trace_bus busrec;
+	long nbus = -1;		// bus voices read for the next block, -1 if not subscribed
+	long npending = 0, maxpending = 0, block = 0, maxframes = 0, numins = 0, numouts = 0, i, j, k;
+	uint64_t frame;
+	size_t at;
+	char *payload;
+	char args[32];
+	int err = 0;
+
+	fp = fopen(r->path, "rb");
+	if(!fp || fread(&hdr, sizeof(hdr), 1, fp) != 1 || memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic))){
+		fprintf(stderr, "bounce_replay: %s is not a db.bounce~ trace\n", r->path);
+		if(fp) fclose(fp);
+		return -1;
+	}
+	if(hdr.version != TRACE_VERSION || hdr.voice_cap < 1 || 2 + 2 * hdr.voice_cap > REPLAY_MAXINS){
+		fprintf(stderr, "bounce_replay: %s - unsupported trace (version %u, %u voices)\n", r->path, hdr.version, hdr.voice_cap);
+		fclose(fp);
+		return -1;
+	}
+	r->hdr = hdr;
+	snprintf(args, sizeof(args), "%u", hdr.voice_cap);
+	h = bounce_host_new(args, hdr.srate);
+	numins = bounce_host_numins(h);
+	numouts = bounce_host_numouts(h);
+	memset(ins, 0, sizeof(ins));
+	memset(outs, 0, sizeof(outs));
+
+	while(fread(&rec, sizeof(rec), 1, fp) == 1){
+		payload = (char *) malloc(rec.size ? rec.size : 1);
+		if(fread(payload, 1, rec.size, fp) != rec.size){
+			fprintf(stderr, "bounce_replay: %s is truncated\n", r->path);
+			free(payload);
+			break;
+		}
+		switch(rec.type){
+			case TRACE_STATE:
+				state = (double *) (payload + sizeof(uint64_t));
+				if(bounce_host_restore(h, state, (rec.size - sizeof(uint64_t)) / sizeof(double))){
+					fprintf(stderr, "bounce_replay: state doesn't match this build of db.bounce~\n");
+					err = -1;
+				}
+				free(payload);
+				break;
+
+			case TRACE_FLOAT:
+			case TRACE_MSG:
+			case TRACE_DSP:
+				if(npending == maxpending){
+					maxpending = maxpending ? 2 * maxpending : 64;
+					pending = (t_pending *) realloc(pending, maxpending * sizeof(t_pending));
+				}
+				pending[npending].type = rec.type;
+				pending[npending].size = rec.size;
+				pending[npending].payload = payload;
+				npending++;
+				if(pass == 0){
+					if(rec.type == TRACE_FLOAT) r->nfloats++;
+					else if(rec.type == TRACE_MSG) r->nmsgs++;
+					else r->ndsp++;
+				}
+				break;
+
+			case TRACE_BUS:
+				memcpy(&busrec, payload, sizeof(busrec));
+				nbus = busrec.count < TRACE_BUS_VOICES ? busrec.count : TRACE_BUS_VOICES;
+				memcpy(bus, payload + sizeof(busrec), nbus * sizeof(double));
+				free(payload);
+				break;
+
+			case TRACE_GAP:
+				memcpy(&frame, payload, sizeof(frame));
+				if(frame < r->gap_frame) r->gap_frame = frame;
+				free(payload);
+				break;
+
+			case TRACE_BLOCK:
+				memcpy(&blk, payload, sizeof(blk));
+				if(blk.frames > maxframes){
+					maxframes = blk.frames;
+					for(i = 0; i < numins; i++){
+						ins[i] = (double *) realloc(ins[i], maxframes * sizeof(double));
+					}
+					for(i = 0; i < numouts; i++){
+						outs[i] = (double *) realloc(outs[i], maxframes * sizeof(double));
+					}
+					silence = (double *) realloc(silence, maxframes * sizeof(double));
+					memset(silence, 0, maxframes * sizeof(double));
+				}
+
+				// floats & messages recorded up to this vector, in the order they arrived
+				for(i = j = 0; i < npending; i++){
+					memcpy(&frame, pending[i].payload, sizeof(frame));
+					if(frame <= blk.frame){
+						replay_apply(h, pending + i);
+						free(pending[i].payload);
+					} else {
+						pending[j++] = pending[i];
+					}
+				}
+				k = npending - j;
+				npending = j;
+				if(nbus >= 0){
+					bounce_host_busfeed(h, bus, nbus);
+					nbus = -1;
+				}
+
+				// inputs: connected inlets from the trace, the rest unread by the kernel
+				at = sizeof(blk);
+				for(i = 0; i < numins; i++){
+					if(blk.conn & (1u << i)){
+						if(blk.constant & (1u << i)){
+							for(j = 0; j < blk.frames; j++){
+								memcpy(ins[i] + j, payload + at, sizeof(double));
+							}
+							at += sizeof(double);
+						} else {
+							memcpy(ins[i], payload + at, blk.frames * sizeof(double));
+							at += blk.frames * sizeof(double);
+						}
+					} else {
+						memcpy(ins[i], silence, blk.frames * sizeof(double));
+					}
+				}
+
+				bounce_host_setlevel(h, blk.gov_level);
+				start = replay_now();
+				bounce_host_perform(h, ins, outs, blk.frames);
+				ns = replay_now() - start;
+
+				if(pass == 0){
+					if(r->nblocks == r->maxblocks){
+						r->maxblocks = r->maxblocks ? 2 * r->maxblocks : 4096;
+						r->blocks = (t_blockstat *) realloc(r->blocks, r->maxblocks * sizeof(t_blockstat));
+					}
+					r->blocks[block].frame = blk.frame;
+					r->blocks[block].frames = blk.frames;
+					r->blocks[block].events = (uint32_t) k;
+					r->blocks[block].ns = ns;
+					r->blocks[block].rec_ns = (double) blk.perform_ns;
+					r->nblocks++;
+					r->frames += blk.frames;
+					if(r->mismatch < 0 && blk.frame < r->gap_frame
+						&& bounce_trace_checksum(outs, numouts, blk.frames) != blk.checksum){
+						r->mismatch = block;
+					}
+					if(r->out){
+						for(j = 0; j < blk.frames; j++){
+							for(i = 0; i < numouts; i++){
+								fwrite(outs[i] + j, sizeof(double), 1, r->out);
+							}
+						}
+					}
+				} else if(block < r->nblocks && ns < r->blocks[block].ns){
+					r->blocks[block].ns = ns;
+				}
+				block++;
+				free(payload);
+				break;
+
+			default:
+				free(payload);
+				break;
+		}
+		if(err){
+			break;
+		}
+	}
+
+	for(i = 0; i < npending; i++){
+		free(pending[i].payload);
+	}
+	free(pending);
+	for(i = 0; i < numins; i++){
+		free(ins[i]);
+	}
+	for(i = 0; i < numouts; i++){
+		free(outs[i]);
+	}
+	free(silence);
+	bounce_host_free(h);
+	fclose(fp);
+	return err;
+}
+
+static int replay_cmp(const void *a, const void *b)
+{
+	double d = *(const double *) a - *(const double *) b;
+	return (d > 0) - (d < 0);
+}
+
+static int replay_cmp_block(const void *a, const void *b)
+{
+	double d = ((const t_blockstat *) b)->ns - ((const t_blockstat *) a)->ns;
+	return (d > 0) - (d < 0);
+}
+
+// mean, p50, p99, p99.9, max of per-vector ns
+static void replay_stats(const char *label, t_replay *r, int recorded)
+{
+	double *t = (double *) malloc(r->nblocks * sizeof(double)), sum = 0;
+	long i, n = r->nblocks;
+
+	for(i = 0; i < n; i++){
+		t[i] = recorded ? r->blocks[i].rec_ns : r->blocks[i].ns;
+		sum += t[i];
+	}
+	qsort(t, n, sizeof(double), replay_cmp);
+	printf("  %-9s %10.0f %10.0f %10.0f %10.0f %10.0f\n", label, sum / n,
+		t[n / 2], t[(long) (n * 0.99)], t[(long) (n * 0.999)], t[n - 1]);
+	free(t);
+}
+
+int main(int argc, char **argv)
+{
+	t_replay r;
+	t_blockstat *b;
+	const char *outpath = NULL;
+	long repeat = 1, top = REPLAY_TOP, i;
+	int pass;
+
+	memset(&r, 0, sizeof(r));
+	r.gap_frame = UINT64_MAX;
+	r.mismatch = -1;
+	for(i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = atol(argv[++i]);
+		else if(!strcmp(argv[i], "--top") && i + 1 < argc) top = atol(argv[++i]);
+		else if(!strcmp(argv[i], "--out") && i + 1 < argc) outpath = argv[++i];
+		else if(argv[i][0] != '-' && !r.path) r.path = argv[i];
+		else r.path = NULL, i = argc;
+	}
+	if(!r.path){
+		fprintf(stderr, "usage: bounce_replay <trace> [--repeat N] [--top N] [--out file]\n");
+		return 1;
+	}
+	if(outpath && !(r.out = fopen(outpath, "wb"))){
+		fprintf(stderr, "bounce_replay: can't write %s\n", outpath);
+		return 1;
+	}
+
+	bounce_host_quiet(1);
+	bounce_host_init();
+	for(pass = 0; pass < (repeat < 1 ? 1 : repeat); pass++){
+		if(replay_pass(&r, pass)){
+			return 1;
+		}
+	}
+	if(r.out){
+		fclose(r.out);
+	}
+	if(!r.nblocks){
+		fprintf(stderr, "bounce_replay: %s has no audio (was dsp running while recording?)\n", r.path);
+		return 1;
+	}
+
+	printf("trace %s: %u voices, %.0f Hz\n", r.path, r.hdr.voice_cap, r.hdr.srate);
+	printf("  %ld vectors, %.2f s, %ld floats, %ld messages, %ld dsp changes\n",
+		r.nblocks, r.frames / r.hdr.srate, r.nfloats, r.nmsgs, r.ndsp);
+	if(r.mismatch >= 0){
+		printf("replay DIFFERS from the recording from vector %ld (frame %llu)\n", r.mismatch,
+			(unsigned long long) r.blocks[r.mismatch].frame);
+	} else {
+		printf("replay output matches the recording%s\n", r.gap_frame == UINT64_MAX ? "" : " up to the first gap");
+	}
+	if(r.gap_frame != UINT64_MAX){
+		printf("trace has gaps (recording buffer overflowed) from %.2f s - the replay can't follow the object after that\n",
+			r.gap_frame / r.hdr.srate);
+	}
+
+	printf("\nperform ns per vector%s   mean        p50        p99      p99.9        max\n",
+		repeat > 1 ? " (replay: best of passes)" : "");
+	replay_stats("replay", &r, 0);
+	replay_stats("recorded", &r, 1);
+
+	qsort(r.blocks, r.nblocks, sizeof(t_blockstat), replay_cmp_block);
+	printf("\nslowest vectors in replay\n");
+	printf("%12s %8s %8s %12s %12s %9s %7s\n", "frame", "secs", "frames", "replay ns", "recorded ns", "% vector", "events");
+	for(i = 0; i < top && i < r.nblocks; i++){
+		b = r.blocks + i;
+		printf("%12llu %8.3f %8u %12.0f %12.0f %9.1f %7u\n", (unsigned long long) b->frame, b->frame / r.hdr.srate,
+			b->frames, b->ns, b->rec_ns, 100. * b->ns * r.hdr.srate / (b->frames * 1e9), b->events);
+	}
+	free(r.blocks);
+	return r.mismatch >= 0 ? 2 : 0;
+}
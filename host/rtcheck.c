@@ -0,0 +1,564 @@
+/*
+ *	rtcheck.c
+ *	DESCRIPTION:	Real-time safety check for db.bounce~'s perform path (bounce_PerformWrapper
+ *					and everything below it), run with "make -C host rtcheck".
+ *
+ *					bounce_rtcheck [--seconds S] [--seed N] [--budget F] [--p999]
+ *
+ *					Interposes the allocator and mmap, mutex / spinlock / condition /
+ *					semaphore waits, sleeps and yields, and file & stdio calls (so post()
+ *					too, and the _FORTIFY_SOURCE printf variants) for the whole process,
+ *					and flags any of them made while a perform call is running. Perform is
+ *					driven with randomised objects (voices, mode, sample rate, vector size,
+ *					connections), signals (collapsing bounds, hz past the fmax clamp,
+ *					symmetry out of range...) and messages between vectors, including
+ *					"record", "governor" and buses (publishing to and subscribing from
+ *					buses earlier objects left behind, or its own). Perform time is taken
+ *					in thread CPU time so preemption doesn't count, summed over at least
+ *					RT_IOFRAMES frames (the deadline is the audio interface's buffer, which
+ *					Max fills with as many signal vectors as it takes), as a share of their
+ *					duration: the worst buffer must stay under --budget (default RT_BUDGET)
+ *					less the clock's own noise once per perform call in it. The noise is
+ *					the longest an empty pair of clock reads took, timed for RT_CALIBRATE
+ *					seconds before each object, so timer ticks and VM steal (which land in
+ *					thread CPU time) are allowed for as far as the machine shows them.
+ *					--p999 judges the 99.9th percentile instead, for machines too busy for
+ *					that. Both are reported.
+ *
+ *					Exits non-zero on any violation. Linux / glibc only.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "bounce_host.h"
+
+char	*t_getbytes(long size);
+void	t_freebytes(void *b, long size);
+
+#define RT_SECONDS 20.			// default run length
+#define RT_BUDGET 0.5			// default worst case, share of the buffer duration
+#define RT_IOFRAMES 64			// smallest audio buffer judged against the budget
+#define RT_MAXVIOL 64			// violations kept for the report
+#define RT_BOOT 65536			// allocations made while the real allocator is looked up
+#define RT_MAXINS 22
+#define RT_MAXFRAMES 4096
+#define RT_CALIBRATE 0.1		// seconds spent measuring clock noise before each object
+#define RT_HIST 1000			// perform time histogram, 1% of the vector per bucket
+
+
+/************************************************************
+!!!!!!!!!!!!	INTERPOSED CALLS		!!!!!!!!!!!!
+*************************************************************/
+
+typedef struct _rt_violation {
+	const char	*call;
+	void		*caller;
+} t_rt_violation;
+
+static __thread int rt_in_perform;		// set around each perform call
+static t_rt_violation rt_viol[RT_MAXVIOL];
+static long rt_nviol;
+
+static void *(*rt_malloc)(size_t);
+static void *(*rt_calloc)(size_t, size_t);
+static void *(*rt_realloc)(void *, size_t);
+static void (*rt_free)(void *);
+static int (*rt_vfprintf)(FILE *, const char *, va_list);
+static char rt_boot[RT_BOOT];
+static size_t rt_boot_used;
+static int rt_resolving;
+
+// no allocation or I/O in here - it runs inside the call being flagged
+static void rt_hit(const char *call, void *caller)
+{
+	if(!rt_in_perform){
+		return;
+	}
+	if(rt_nviol < RT_MAXVIOL){
+		rt_viol[rt_nviol].call = call;
+		rt_viol[rt_nviol].caller = caller;
+	}
+	rt_nviol++;
+}
+
+// dlsym may allocate before the real allocator is known - serve that from rt_boot
+static void *rt_boot_alloc(size_t n)
+{
+	void *p;
+	n = (n + 15) & ~(size_t) 15;
+	if(rt_boot_used + n > RT_BOOT){
+		return NULL;
+	}
+	p = rt_boot + rt_boot_used;
+	rt_boot_used += n;
+	return p;
+}
+
+static int rt_is_boot(void *p)
+{
+	return (char *) p >= rt_boot && (char *) p < rt_boot + RT_BOOT;
+}
+
+__attribute__((constructor)) static void rt_resolve(void)
+{
+	if(rt_malloc || rt_resolving){
+		return;
+	}
+	rt_resolving = 1;
+	rt_malloc = (void *(*)(size_t)) dlsym(RTLD_NEXT, "malloc");
+	rt_calloc = (void *(*)(size_t, size_t)) dlsym(RTLD_NEXT, "calloc");
+	rt_realloc = (void *(*)(void *, size_t)) dlsym(RTLD_NEXT, "realloc");
+	rt_free = (void (*)(void *)) dlsym(RTLD_NEXT, "free");
+	rt_vfprintf = (int (*)(FILE *, const char *, va_list)) dlsym(RTLD_NEXT, "vfprintf");
+	rt_resolving = 0;
+}
+
+void *malloc(size_t n)
+{
+	rt_hit("malloc", __builtin_return_address(0));
+	rt_resolve();
+	return rt_malloc ? rt_malloc(n) : rt_boot_alloc(n);
+}
+
+void *calloc(size_t n, size_t size)
+{
+	rt_hit("calloc", __builtin_return_address(0));
+	rt_resolve();
+	return rt_calloc ? rt_calloc(n, size) : rt_boot_alloc(n * size);	// rt_boot is zeroed
+}
+
+void *realloc(void *p, size_t n)
+{
+	void *q;
+	size_t keep;
+	rt_hit("realloc", __builtin_return_address(0));
+	rt_resolve();
+	if(rt_is_boot(p)){	// old size unknown - copy what could be there
+		keep = rt_boot + RT_BOOT - (char *) p;
+		q = malloc(n);
+		memcpy(q, p, n < keep ? n : keep);
+		return q;
+	}
+	return rt_realloc(p, n);
+}
+
+void free(void *p)
+{
+	rt_hit("free", __builtin_return_address(0));
+	if(p && !rt_is_boot(p)){
+		rt_resolve();
+		rt_free(p);
+	}
+}
+
+// everything else: flag, then pass straight through to libc
+#define RT_WRAP(ret, name, params, args) \
+	ret name params \
+	{ \
+		static ret (*real) params; \
+		rt_hit(#name, __builtin_return_address(0)); \
+		if(!real) real = (ret (*) params) dlsym(RTLD_NEXT, #name); \
+		return real args; \
+	}
+
+RT_WRAP(int, posix_memalign, (void **p, size_t a, size_t n), (p, a, n))
+RT_WRAP(void *, aligned_alloc, (size_t a, size_t n), (a, n))
+RT_WRAP(void *, mmap, (void *a, size_t n, int prot, int flags, int fd, off_t off), (a, n, prot, flags, fd, off))
+RT_WRAP(int, pthread_mutex_lock, (pthread_mutex_t *m), (m))
+RT_WRAP(int, pthread_mutex_trylock, (pthread_mutex_t *m), (m))
+RT_WRAP(int, pthread_spin_lock, (pthread_spinlock_t *l), (l))
+RT_WRAP(int, pthread_rwlock_rdlock, (pthread_rwlock_t *l), (l))
+RT_WRAP(int, pthread_rwlock_wrlock, (pthread_rwlock_t *l), (l))
+RT_WRAP(int, pthread_cond_wait, (pthread_cond_t *c, pthread_mutex_t *m), (c, m))
+RT_WRAP(int, pthread_cond_timedwait, (pthread_cond_t *c, pthread_mutex_t *m, const struct timespec *t), (c, m, t))
+RT_WRAP(int, sem_wait, (sem_t *s), (s))
+RT_WRAP(int, sem_timedwait, (sem_t *s, const struct timespec *t), (s, t))
+RT_WRAP(int, nanosleep, (const struct timespec *t, struct timespec *r), (t, r))
+RT_WRAP(int, clock_nanosleep, (clockid_t c, int flags, const struct timespec *t, struct timespec *r), (c, flags, t, r))
+RT_WRAP(int, usleep, (useconds_t t), (t))
+RT_WRAP(int, sched_yield, (void), ())
+RT_WRAP(FILE *, fopen, (const char *p, const char *m), (p, m))
+RT_WRAP(int, fclose, (FILE *f), (f))
+RT_WRAP(size_t, fread, (void *p, size_t s, size_t n, FILE *f), (p, s, n, f))
+RT_WRAP(size_t, fwrite, (const void *p, size_t s, size_t n, FILE *f), (p, s, n, f))
+RT_WRAP(int, fflush, (FILE *f), (f))
+RT_WRAP(int, fputc, (int c, FILE *f), (c, f))
+RT_WRAP(int, fputs, (const char *s, FILE *f), (s, f))
+RT_WRAP(int, puts, (const char *s), (s))
+RT_WRAP(int, putchar, (int c), (c))
+RT_WRAP(int, putc, (int c, FILE *f), (c, f))		// putchar, inlined
+RT_WRAP(ssize_t, read, (int fd, void *p, size_t n), (fd, p, n))
+RT_WRAP(ssize_t, write, (int fd, const void *p, size_t n), (fd, p, n))
+RT_WRAP(int, close, (int fd), (fd))
+
+// open & open64 - the mode is only there with O_CREAT
+#define RT_WRAP_OPEN(name) \
+	int name(const char *path, int flags, ...) \
+	{ \
+		static int (*real)(const char *, int, ...); \
+		va_list args; \
+		mode_t mode = 0; \
+		rt_hit(#name, __builtin_return_address(0)); \
+		if(!real) real = (int (*)(const char *, int, ...)) dlsym(RTLD_NEXT, #name); \
+		if(flags & O_CREAT){ \
+			va_start(args, flags); \
+			mode = va_arg(args, mode_t); \
+			va_end(args); \
+		} \
+		return real(path, flags, mode); \
+	}
+
+RT_WRAP_OPEN(open)
+RT_WRAP_OPEN(open64)
+
+int vfprintf(FILE *f, const char *fmt, va_list args)
+{
+	rt_hit("vfprintf", __builtin_return_address(0));
+	rt_resolve();
+	return rt_vfprintf(f, fmt, args);
+}
+
+int fprintf(FILE *f, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+	rt_hit("fprintf", __builtin_return_address(0));
+	va_start(args, fmt);
+	n = rt_vfprintf(f, fmt, args);
+	va_end(args);
+	return n;
+}
+
+int printf(const char *fmt, ...)
+{
+	va_list args;
+	int n;
+	rt_hit("printf", __builtin_return_address(0));
+	va_start(args, fmt);
+	n = rt_vfprintf(stdout, fmt, args);
+	va_end(args);
+	return n;
+}
+
+int vprintf(const char *fmt, va_list args)
+{
+	rt_hit("vprintf", __builtin_return_address(0));
+	rt_resolve();
+	return rt_vfprintf(stdout, fmt, args);
+}
+
+// what printf & co. compile to under _FORTIFY_SOURCE - flag only, the format checks are skipped
+int __vfprintf_chk(FILE *f, int flag, const char *fmt, va_list args)
+{
+	rt_hit("__vfprintf_chk", __builtin_return_address(0));
+	rt_resolve();
+	return rt_vfprintf(f, fmt, args);
+}
+
+int __fprintf_chk(FILE *f, int flag, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+	rt_hit("__fprintf_chk", __builtin_return_address(0));
+	va_start(args, fmt);
+	n = rt_vfprintf(f, fmt, args);
+	va_end(args);
+	return n;
+}
+
+int __printf_chk(int flag, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+	rt_hit("__printf_chk", __builtin_return_address(0));
+	va_start(args, fmt);
+	n = rt_vfprintf(stdout, fmt, args);
+	va_end(args);
+	return n;
+}
+
+
+/************************************************************
+!!!!!!!!!!!!	RANDOMISED RUNS		!!!!!!!!!!!!
+*************************************************************/
+
+static uint64_t rt_rng;
+
+static double rt_rand(void)		// 0..1, xorshift64*
+{
+	rt_rng ^= rt_rng >> 12, rt_rng ^= rt_rng << 25, rt_rng ^= rt_rng >> 27;
+	return ((rt_rng * 2685821657736338717ULL) >> 11) * (1. / 9007199254740992.);
+}
+
+static long rt_irand(long n)
+{
+	return (long) (rt_rand() * n);
+}
+
+static double rt_uniform(double lo, double hi)
+{
+	return lo + rt_rand() * (hi - lo);
+}
+
+static double rt_now(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+typedef struct _rt_config {
+	long	voices;
+	long	active;
+	long	mode;
+	double	srate;
+	long	vectorsize;
+	short	conn[RT_MAXINS];
+} t_rt_config;
+
+// a vector of input for inlet i: mostly plausible, sometimes hostile
+static void rt_signal(double *s, long frames, long inlet, long voices, double *phase)
+{
+	long i, kind = rt_irand(6);
+	double a, b;
+
+	if(inlet < 2){		// bounds - including collapsing onto each other
+		a = inlet == 0 ? rt_uniform(-1.5, 0.5) : rt_uniform(-0.5, 1.5);
+		b = kind == 0 ? rt_uniform(-0.003, 0.003) : rt_uniform(-0.2, 0.2);
+	} else if(inlet < voices + 2){	// hz - including negative, 0 and past the fmax clamp
+		a = kind == 0 ? 0 : kind == 1 ? rt_uniform(20000, 40000) : rt_uniform(-200, 3000);
+		b = rt_uniform(0, a * 0.5 + 1);
+	} else {			// symmetry - including out of range
+		a = rt_uniform(-0.2, 1.2);
+		b = rt_uniform(0, 0.5);
+	}
+	for(i = 0; i < frames; i++){
+		switch(kind){
+			case 0: case 1: s[i] = a; break;										// constant
+			case 2: s[i] = a + b * sin(*phase += 0.01); break;						// slow sweep
+			case 3: s[i] = a + b * (rt_rand() * 2 - 1); break;						// noise
+			case 4: s[i] = a + (rt_irand(64) ? 0 : rt_uniform(-1, 1) * (b + 1)); break;	// spikes
+			default: s[i] = a + b * (i & 32 ? 1 : -1); break;						// square
+		}
+	}
+}
+
+// a random message (or float) between vectors
+static void rt_message(t_bounce_host *h, t_rt_config *c, const char *trace)
+{
+	char msg[128];
+	long i, n;
+
+	switch(rt_irand(17)){
+		case 0: snprintf(msg, sizeof(msg), "fm %ld %ld %f", 1 + rt_irand(c->voices), 1 + rt_irand(c->voices), rt_uniform(-3, 3)); break;
+		case 1: snprintf(msg, sizeof(msg), "fmoff"); break;
+		case 2: snprintf(msg, sizeof(msg), "shape %ld %f", 1 + rt_irand(c->voices), rt_uniform(-1.2, 1.2)); break;
+		case 3:
+			n = snprintf(msg, sizeof(msg), "dc");
+			for(i = 0; i < c->voices; i++) n += snprintf(msg + n, sizeof(msg) - n, " %ld", rt_irand(2));
+			break;
+		case 4: snprintf(msg, sizeof(msg), "fmax %f", rt_uniform(1, 16000)); break;
+		case 5: snprintf(msg, sizeof(msg), "voices %ld", 1 + rt_irand(c->voices)); break;
+		case 6: snprintf(msg, sizeof(msg), "mode %ld", rt_irand(2)); break;
+		case 7: snprintf(msg, sizeof(msg), "fmrate %ld", rt_irand(3) ? 1 + rt_irand(64) : 1); break;
+		case 8: snprintf(msg, sizeof(msg), "fminterp %ld", rt_irand(2)); break;
+		case 9: snprintf(msg, sizeof(msg), "governor %ld %f", rt_irand(2), rt_uniform(0.02, 0.5)); break;
+		case 10: snprintf(msg, sizeof(msg), rt_irand(2) ? "record %s" : "record", trace); break;
+		case 11: snprintf(msg, sizeof(msg), "lfo %ld", rt_irand(2)); break;
+		case 12: snprintf(msg, sizeof(msg), rt_irand(3) ? "publish rtbus%ld" : "publish", rt_irand(2)); break;
+		case 13: snprintf(msg, sizeof(msg), rt_irand(3) ? "subscribe rtbus%ld" : "subscribe", rt_irand(2)); break;
+		case 14: snprintf(msg, sizeof(msg), "busbound %s %ld", rt_irand(2) ? "lo" : "hi", rt_irand(12)); break;
+		case 15: snprintf(msg, sizeof(msg), "busfm %ld %ld %f", 1 + rt_irand(10), 1 + rt_irand(c->voices), rt_uniform(-3, 3)); break;
+		default:
+			bounce_host_float(h, rt_irand(2 + 2 * c->voices), rt_uniform(-2, 2) * (rt_irand(2) ? 1 : 5000));
+			return;
+	}
+	bounce_host_send(h, msg);
+}
+
+static void rt_describe(t_rt_config *c, char *dst, size_t n)
+{
+	long i, k;
+	k = snprintf(dst, n, "%ld voices (%ld running), mode %ld, %.0f Hz, vector %ld, signals ",
+		c->voices, c->active, c->mode, c->srate, c->vectorsize);
+	for(i = 0; i < 2 + 2 * c->voices && k < (long) n - 1; i++){
+		dst[k++] = c->conn[i] ? '1' : '0';
+	}
+	dst[k] = '\0';
+}
+
+static void rt_report_violations(long from, t_rt_config *c, long block)
+{
+	char desc[256];
+	Dl_info info;
+	long i;
+
+	rt_describe(c, desc, sizeof(desc));
+	printf("VIOLATION in perform (vector %ld of %s):\n", block, desc);
+	for(i = from; i < rt_nviol && i < RT_MAXVIOL; i++){
+		if(dladdr(rt_viol[i].caller, &info) && info.dli_sname){
+			printf("  %s called from %s+0x%lx\n", rt_viol[i].call, info.dli_sname,
+				(long) ((char *) rt_viol[i].caller - (char *) info.dli_saddr));
+		} else {
+			printf("  %s called from %p\n", rt_viol[i].call, rt_viol[i].caller);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static double inbuf[RT_MAXINS][RT_MAXFRAMES], outbuf[RT_MAXINS][RT_MAXFRAMES];
+	static const double srates[] = { 22050, 44100, 48000, 96000, 192000 };
+	static const long vectors[] = { 1, 2, 7, 16, 32, 64, 64, 128, 256, 512, 1000, 2048, 4096 };
+	double *ins[RT_MAXINS], *outs[RT_MAXINS], phase[RT_MAXINS];
+	static long hist[RT_HIST + 1];
+	double seconds = RT_SECONDS, budget = RT_BUDGET, start, cpu, wall, share, worst = 0, worst_wall = 0, audio = 0;
+	double noise = 0, excess = 0, p999 = 0, io_cpu, io_wall;
+	long io_frames, io_calls;
+	int judge_p999 = 0;
+	char args[64], trace[64], worst_desc[256] = "";
+	long i, b, blocks, configs = 0, performs = 0, ios = 0, reported = 0;
+	t_rt_config c;
+	t_bounce_host *h;
+	char *canary;
+
+	rt_rng = (uint64_t) time(NULL);
+	for(i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--seed") && i + 1 < argc) rt_rng = strtoull(argv[++i], NULL, 0);
+		else if(!strcmp(argv[i], "--budget") && i + 1 < argc) budget = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--p999")) judge_p999 = 1;
+		else {
+			fprintf(stderr, "usage: bounce_rtcheck [--seconds S] [--seed N] [--budget F] [--p999]\n");
+			return 1;
+		}
+	}
+	printf("db.bounce~ real-time check: seed %llu, %.0f s, budget %.0f%% of the vector%s\n",
+		(unsigned long long) rt_rng, seconds, budget * 100, judge_p999 ? " (99.9th percentile)" : " (worst buffer)");
+	if(!rt_rng) rt_rng = 1;
+
+	// make sure the interposition works before trusting a clean run
+	rt_in_perform = 1;
+	canary = t_getbytes(16);		// maxstub.c, so the compiler can't drop the pair
+	t_freebytes(canary, 16);
+	rt_in_perform = 0;
+	if(rt_nviol != 2){
+		printf("FAIL: allocator interposition isn't working (%ld calls seen)\n", rt_nviol);
+		return 1;
+	}
+	rt_nviol = 0;
+
+	bounce_host_quiet(0);				// post() must reach stdio so it gets caught
+	if(!freopen("/dev/null", "w", stderr)) return 1;
+	bounce_host_init();
+	snprintf(trace, sizeof(trace), "/tmp/bounce_rtcheck_%d.trace", (int) getpid());
+	for(i = 0; i < RT_MAXINS; i++){
+		ins[i] = inbuf[i], outs[i] = outbuf[i];
+	}
+
+	for(start = rt_now(CLOCK_MONOTONIC); rt_now(CLOCK_MONOTONIC) - start < seconds * 1e9; configs++){
+		// clock noise as the machine shows it now, allowed for this object's buffers (and later ones)
+		for(wall = rt_now(CLOCK_MONOTONIC); rt_now(CLOCK_MONOTONIC) - wall < RT_CALIBRATE * 1e9; ){
+			cpu = rt_now(CLOCK_THREAD_CPUTIME_ID);
+			cpu = rt_now(CLOCK_THREAD_CPUTIME_ID) - cpu;
+			if(cpu > noise) noise = cpu;
+		}
+		c.voices = 1 + rt_irand(10);
+		c.active = 1 + rt_irand(c.voices);
+		c.mode = rt_irand(2);
+		c.srate = srates[rt_irand(sizeof(srates) / sizeof(srates[0]))];
+		c.vectorsize = vectors[rt_irand(sizeof(vectors) / sizeof(vectors[0]))];
+		snprintf(args, sizeof(args), "%ld %f %f %ld %ld", c.voices, rt_uniform(-1.2, -0.5), rt_uniform(0.5, 1.2), c.mode, c.active);
+		h = bounce_host_new(args, c.srate);
+		for(i = 0; i < 2 + 2 * c.voices; i++){
+			c.conn[i] = (short) rt_irand(2);
+			phase[i] = 0;
+		}
+		bounce_host_dsp(h, c.conn, c.vectorsize);
+		for(i = 2; i < 2 + 2 * c.voices; i++){
+			bounce_host_float(h, i, i < 2 + c.voices ? rt_uniform(0.5, 2000) : rt_uniform(0, 1));
+		}
+
+		blocks = 1 + rt_irand(20 * c.srate / c.vectorsize);	// up to ~20 s of audio each
+		io_cpu = io_wall = 0, io_frames = io_calls = 0;
+		for(b = 0; b < blocks; b++){
+			if(!rt_irand(32)){
+				rt_message(h, &c, trace);
+			}
+			for(i = 0; i < 2 + 2 * c.voices; i++){
+				if(c.conn[i] && (b == 0 || !rt_irand(8))){
+					rt_signal(inbuf[i], c.vectorsize, i, c.voices, phase + i);
+				}
+			}
+
+			rt_in_perform = 1;
+			cpu = rt_now(CLOCK_THREAD_CPUTIME_ID);
+			wall = rt_now(CLOCK_MONOTONIC);
+			bounce_host_perform(h, ins, outs, c.vectorsize);
+			wall = rt_now(CLOCK_MONOTONIC) - wall;
+			cpu = rt_now(CLOCK_THREAD_CPUTIME_ID) - cpu;
+			rt_in_perform = 0;
+
+			performs++;
+			audio += c.vectorsize / c.srate;
+			if(rt_nviol > reported){
+				if(reported < RT_MAXVIOL){
+					rt_report_violations(reported, &c, b);
+				}
+				reported = rt_nviol;
+			}
+			io_cpu += cpu, io_wall += wall, io_frames += c.vectorsize, io_calls++;
+			if(io_frames >= RT_IOFRAMES){
+				ios++;
+				share = io_cpu * c.srate / (io_frames * 1e9);
+				hist[share * 100 < RT_HIST ? (long) (share * 100) : RT_HIST]++;
+				if(share > worst){
+					worst = share;
+					rt_describe(&c, worst_desc, sizeof(worst_desc));
+				}
+				share = (io_cpu - noise * io_calls) * c.srate / (io_frames * 1e9);	// each call read the clock
+				if(share > excess) excess = share;
+				share = io_wall * c.srate / (io_frames * 1e9);
+				if(share > worst_wall) worst_wall = share;
+				io_cpu = io_wall = 0, io_frames = io_calls = 0;
+			}
+			if(!(b & 15)){
+				bounce_host_idle();		// main thread work - trace writing, governor reports
+			}
+		}
+		bounce_host_send(h, "record");
+		bounce_host_free(h);
+	}
+	remove(trace);
+
+	printf("%ld objects, %ld perform calls, %.1f s of audio\n", configs, performs, audio);
+	printf("allocation, locking or blocking I/O in perform: %ld call%s\n", rt_nviol, rt_nviol == 1 ? "" : "s");
+	for(i = 0, b = 0; i <= RT_HIST && b < ios - ios / 1000; i++){
+		b += hist[i];
+		p999 = (i + 1) / 100.;
+	}
+	printf("perform time, share of each %d+ frame buffer in thread CPU time: worst %.1f%% (%.1f%% wall clock),\n",
+		RT_IOFRAMES, worst * 100, worst_wall * 100);
+	printf("%.1f%% less clock noise of up to %.0f us per call. 99.9th percentile under %.0f%%\n",
+		excess > 0 ? excess * 100 : 0, noise / 1000, p999 * 100);
+	printf("  %s\n", worst_desc);
+	if(rt_nviol || (judge_p999 ? p999 : excess) > budget){
+		printf("FAIL\n");
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ *	spectrum.c
+ *	DESCRIPTION:	Small FFT / power spectrum helpers for the db.bounce~ benchmarks.
+ *					Radix-2, double precision - fine for offline analysis, not for
+ *					the audio thread.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "spectrum.h"
+
+#ifndef PI
+	#define PI 3.14159265358979323846
+#endif
+
+void spec_fft(double *re, double *im, long n)
+{
+	long i, j, k, len;
+	double ang, wr, wi, ur, ui, vr, vi, tr, ti, cr, ci;
+
+	// bit reverse
+	for(i = 1, j = 0; i < n; i++){
+		for(k = n >> 1; j & k; k >>= 1){
+			j ^= k;
+		}
+		j |= k;
+		if(i < j){
+			tr = re[i], re[i] = re[j], re[j] = tr;
+			ti = im[i], im[i] = im[j], im[j] = ti;
+		}
+	}
+	// butterflies
+	for(len = 2; len <= n; len <<= 1){
+		ang = -2 * PI / len;
+		wr = cos(ang), wi = sin(ang);
+		for(i = 0; i < n; i += len){
+			cr = 1, ci = 0;
+			for(j = 0; j < len / 2; j++){
+				ur = re[i+j], ui = im[i+j];
+				vr = re[i+j+len/2] * cr - im[i+j+len/2] * ci;
+				vi = re[i+j+len/2] * ci + im[i+j+len/2] * cr;
+				re[i+j] = ur + vr, im[i+j] = ui + vi;
+				re[i+j+len/2] = ur - vr, im[i+j+len/2] = ui - vi;
+				tr = cr * wr - ci * wi;
+				ci = cr * wi + ci * wr;
+				cr = tr;
+			}
+		}
+	}
+}
+
+long spec_welch(const double *x, long len, long nfft, double *psd)
+{
+	double *re, *im, *win;
+	double mean, norm = 0;
+	long i, pos, frames = 0;
+
+	re = (double *) malloc(nfft * sizeof(double));
+	im = (double *) malloc(nfft * sizeof(double));
+	win = (double *) malloc(nfft * sizeof(double));
+	for(i = 0; i < nfft; i++){
+		win[i] = 0.5 - 0.5 * cos(2 * PI * i / nfft);
+		norm += win[i] * win[i];
+	}
+	for(i = 0; i <= nfft / 2; i++){
+		psd[i] = 0;
+	}
+	for(pos = 0; pos + nfft <= len; pos += nfft / 2){
+		mean = 0;
+		for(i = 0; i < nfft; i++){
+			mean += x[pos + i];
+		}
+		mean /= nfft;
+		for(i = 0; i < nfft; i++){
+			re[i] = (x[pos + i] - mean) * win[i];
+			im[i] = 0;
+		}
+		spec_fft(re, im, nfft);
+		for(i = 0; i <= nfft / 2; i++){
+			psd[i] += (re[i] * re[i] + im[i] * im[i]) / norm;
+		}
+		frames++;
+	}
+	if(frames){
+		for(i = 0; i <= nfft / 2; i++){
+			psd[i] /= frames;
+		}
+	}
+	free(re), free(im), free(win);
+	return frames;
+}
+
+void spec_power(const double *x, long nfft, double *power)
+{
+	double *re, *im, w, ph, mean = 0;
+	long i;
+
+	re = (double *) malloc(nfft * sizeof(double));
+	im = (double *) malloc(nfft * sizeof(double));
+	for(i = 0; i < nfft; i++){
+		mean += x[i];
+	}
+	mean /= nfft;
+	for(i = 0; i < nfft; i++){
+		ph = 2 * PI * i / nfft;
+		w = 0.35875 - 0.48829 * cos(ph) + 0.14128 * cos(2 * ph) - 0.01168 * cos(3 * ph);
+		re[i] = (x[i] - mean) * w;
+		im[i] = 0;
+	}
+	spec_fft(re, im, nfft);
+	for(i = 0; i <= nfft / 2; i++){
+		power[i] = re[i] * re[i] + im[i] * im[i];
+	}
+	free(re), free(im);
+}
+
+double spec_db(double power)
+{
+	return 10 * log10(power + 1e-30);
+}
+
+double spec_logdist(const double *a, const double *b, long lo, long hi, double floor_db)
+{
+	double peak = 0, floor, da, db, sum = 0;
+	long i, n = 0;
+
+	for(i = lo; i < hi; i++){
+		if(a[i] > peak) peak = a[i];
+	}
+	floor = spec_db(peak) + floor_db;
+	for(i = lo; i < hi; i++){
+		da = spec_db(a[i]), db = spec_db(b[i]);
+		if(da < floor && db < floor){
+			continue;
+		}
+		da = da < floor ? floor : da;
+		db = db < floor ? floor : db;
+		sum += (da - db) * (da - db);
+		n++;
+	}
+	return n ? sqrt(sum / n) : 0;
+}
@@ -0,0 +1,26 @@
+/*
+ *	spectrum.h
+ *	DESCRIPTION:	Small FFT / power spectrum helpers for the db.bounce~ benchmarks.
+ */
+
+#ifndef BOUNCE_SPECTRUM_H
+#define BOUNCE_SPECTRUM_H
+
+// in place complex FFT, n a power of 2
+void	spec_fft(double *re, double *im, long n);
+
+// Welch power spectrum: Hann window, 50% overlap. psd gets nfft/2 + 1 bins (linear power)
+// returns number of frames averaged
+long	spec_welch(const double *x, long len, long nfft, double *psd);
+
+// RMS difference in dB between two power spectra over bins lo..hi-1, ignoring bins
+// where both are below floor_db relative to the peak of a
+double	spec_logdist(const double *a, const double *b, long lo, long hi, double floor_db);
+
+// single Blackman-Harris windowed power spectrum of x[0..nfft-1]: nfft/2 + 1 bins.
+// ~92 dB sidelobes, main lobe +-4 bins
+void	spec_power(const double *x, long nfft, double *power);
+
+double	spec_db(double power);
+
+#endif
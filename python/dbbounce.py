@@ -0,0 +1,253 @@
+"""
+dbbounce.py
+Python bindings for db.bounce~, over the Linux headless host (host/libdbbounce.so).
+
+The DSP is the same code as the Max external. render() works directly on the
+caller's NumPy buffers - nothing is copied in or out - and the GIL is released
+for the whole render, so separate ensembles can run in parallel Python threads.
+
+    import numpy as np, dbbounce
+    b = dbbounce.Bounce(voices=3, mode=1, samplerate=48000)
+    b.set_hz([110, 165, 220])
+    b.set_fm([[0, .5, 0], [0, 0, .3], [.2, 0, 0]])
+    out = b.render(48000)                  # (3, 48000) float64
+
+    hz = np.tile([[110.], [165.], [220.]], 48000)
+    hz[0] *= np.linspace(1, 4, 48000)      # signal rate input for voice 1
+    b.render(out=out, hz=hz)
+
+Build the library first with "make -C host". DB_BOUNCE_LIB overrides where it
+is loaded from.
+"""
+
+import ctypes
+import os
+import threading
+
+import numpy as np
+
+_DOUBLE_P = ctypes.POINTER(ctypes.c_double)
+
+_lib_path = os.environ.get("DB_BOUNCE_LIB") or os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "host", "libdbbounce.so")
+_lib = ctypes.CDLL(_lib_path)   # CDLL (not PyDLL) - calls release the GIL
+
+_lib.bounce_host_init.restype = ctypes.c_int
+_lib.bounce_host_new.argtypes = [ctypes.c_char_p, ctypes.c_double]
+_lib.bounce_host_new.restype = ctypes.c_void_p
+_lib.bounce_host_free.argtypes = [ctypes.c_void_p]
+_lib.bounce_host_numins.argtypes = [ctypes.c_void_p]
+_lib.bounce_host_numins.restype = ctypes.c_long
+_lib.bounce_host_numouts.argtypes = [ctypes.c_void_p]
+_lib.bounce_host_numouts.restype = ctypes.c_long
+_lib.bounce_host_send.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+_lib.bounce_host_send.restype = ctypes.c_int
+_lib.bounce_host_float.argtypes = [ctypes.c_void_p, ctypes.c_long, ctypes.c_double]
+_lib.bounce_host_dsp.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_short), ctypes.c_long]
+_lib.bounce_host_render.argtypes = [ctypes.c_void_p, ctypes.POINTER(_DOUBLE_P),
+                                    ctypes.POINTER(_DOUBLE_P), ctypes.c_long]
+_lib.bounce_host_quiet.argtypes = [ctypes.c_int]
+_lib.bounce_host_governor.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double)]
+_lib.bounce_host_governor.restype = ctypes.c_long
+
+# object creation and messages go through shared tables (symbols, class) in the
+# host, so they are serialised. Rendering different objects is not.
+_lock = threading.Lock()
+
+_lib.bounce_host_quiet(1)
+_lib.bounce_host_init()
+
+
+def quiet(on=True):
+    """Silence (or restore) post() output from the object."""
+    _lib.bounce_host_quiet(1 if on else 0)
+
+
+def _row_pointers(a, rows, frames, name):
+    """Pointers to the rows of a 2D float64 array, without copying it."""
+    if a.dtype != np.float64 or a.ndim != 2 or a.shape[0] != rows or a.shape[1] < frames:
+        raise ValueError("%s must be float64 with shape (%d, >= %d)" % (name, rows, frames))
+    if a.strides[1] != a.itemsize:
+        raise ValueError("%s rows must be contiguous" % name)
+    base = a.ctypes.data
+    return [ctypes.cast(base + i * a.strides[0], _DOUBLE_P) for i in range(rows)]
+
+
+def _vector_pointer(a, frames, name):
+    if a.dtype != np.float64 or a.ndim != 1 or a.shape[0] < frames or a.strides[0] != a.itemsize:
+        raise ValueError("%s must be contiguous float64 with >= %d samples" % (name, frames))
+    return ctypes.cast(a.ctypes.data, _DOUBLE_P)
+
+
+class Bounce(object):
+    """One db.bounce~ ensemble.
+
+    voices, bound_lo, bound_hi, mode and active are the object's creation args
+    (voices = capacity, active = voices running at start). Parameters set
+    through methods behave like messages / floats to the object's inlets.
+    """
+
+    def __init__(self, voices=1, bound_lo=-1.0, bound_hi=1.0, mode=0, active=None,
+                 samplerate=44100.0, vectorsize=64):
+        args = "%d %r %r %d" % (voices, float(bound_lo), float(bound_hi), mode)
+        if active is not None:
+            args += " %d" % active
+        with _lock:
+            self._h = _lib.bounce_host_new(args.encode(), float(samplerate))
+        if not self._h:
+            raise RuntimeError("could not create db.bounce~")
+        self.voices = _lib.bounce_host_numouts(self._h)
+        self.samplerate = float(samplerate)
+        self.vectorsize = int(vectorsize)
+        self._numins = _lib.bounce_host_numins(self._h)
+        self._connected = None
+        self._dsp((0,) * self._numins)
+
+    def close(self):
+        if self._h:
+            with _lock:
+                _lib.bounce_host_free(self._h)
+            self._h = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    # ---- messages ---------------------------------------------------------
+
+    def send(self, msg):
+        """Send a message as typed in a Max message box, e.g. "fmrate 16"."""
+        with _lock:
+            if _lib.bounce_host_send(self._h, msg.encode()) != 0:
+                raise ValueError("db.bounce~ doesn't understand %r" % msg)
+
+    def _float(self, inlet, value):
+        _lib.bounce_host_float(self._h, inlet, float(value))
+
+    def set_bounds(self, lo, hi):
+        self._float(0, lo)
+        self._float(1, hi)
+
+    def set_hz(self, hz):
+        for v, f in enumerate(np.broadcast_to(hz, (self.voices,))):
+            self._float(2 + v, f)
+
+    def set_symm(self, symm):
+        for v, s in enumerate(np.broadcast_to(symm, (self.voices,))):
+            self._float(2 + self.voices + v, s)
+
+    def set_fm(self, matrix):
+        """Whole cross modulation matrix, matrix[from][to]."""
+        m = np.asarray(matrix, dtype=np.float64)
+        self.send("fmoff")
+        for i, j in zip(*np.nonzero(m)):
+            self.send("fm %d %d %r" % (i + 1, j + 1, float(m[i, j])))
+
+    def set_shape(self, shape):
+        for v, s in enumerate(np.broadcast_to(shape, (self.voices,))):
+            self.send("shape %d %r" % (v + 1, float(s)))
+
+    def set_dcblock(self, on):
+        self.send("dc " + " ".join(str(int(bool(o))) for o in np.broadcast_to(on, (self.voices,))))
+
+    def set_mode(self, mode):
+        self.send("mode %d" % mode)
+
+    def set_voices(self, n):
+        self.send("voices %d" % n)
+
+    def set_lfo(self, on):
+        """Decimated ensemble for sub-audio modulation, outputs interpolated up to the signal rate.
+
+        Single voices track full rate closely. Coupled ensembles don't: from 4 voices
+        at 2 Hz up the output is a different signal, not an approximation (see the README).
+        """
+        self.send("lfo %d" % bool(on))
+
+    def publish(self, bus=None):
+        """Put the ball positions on a named bus after every vector (None stops)."""
+        self.send("publish" if bus is None else "publish %s" % bus)
+
+    def subscribe(self, bus=None):
+        """Read a named bus (for set_busbound / set_busfm) one vector late (None stops).
+
+        Buses are shared by every Bounce in the process, so ensembles coupled
+        this way can render in separate threads.
+        """
+        self.send("subscribe" if bus is None else "subscribe %s" % bus)
+
+    def set_busbound(self, lo=None, hi=None):
+        """Ensemble bounds from bus voices (1-based, 0 = back to the inlet, None = unchanged)."""
+        if lo is not None:
+            self.send("busbound lo %d" % lo)
+        if hi is not None:
+            self.send("busbound hi %d" % hi)
+
+    def set_busfm(self, matrix):
+        """Whole bus cross modulation matrix, matrix[bus voice][voice]."""
+        m = np.asarray(matrix, dtype=np.float64)
+        for i in range(m.shape[0]):
+            for j in range(m.shape[1]):
+                self.send("busfm %d %d %r" % (i + 1, j + 1, float(m[i, j])))
+
+    def set_governor(self, on, budget=None):
+        """CPU governor: budget is the share of each vector's duration allowed."""
+        self.send("governor %d" % bool(on) + ("" if budget is None else " %r" % float(budget)))
+
+    @property
+    def governor(self):
+        """(level, load) - level 0 is full quality, load is smoothed perform time / vector time."""
+        load = ctypes.c_double()
+        level = _lib.bounce_host_governor(self._h, ctypes.byref(load))
+        return level, load.value
+
+    # ---- audio ------------------------------------------------------------
+
+    def _dsp(self, connected):
+        if connected != self._connected:
+            flags = (ctypes.c_short * self._numins)(*connected)
+            _lib.bounce_host_dsp(self._h, flags, self.vectorsize)
+            self._connected = connected
+
+    def render(self, frames=None, out=None, bound_lo=None, bound_hi=None, hz=None, symm=None):
+        """Render into out, shape (voices, frames), allocated if None.
+
+        Signal inputs are used in place and only read: bound_lo / bound_hi are
+        1D, hz / symm are (voices, frames). Inputs left as None use the values
+        from the set_ methods, like unconnected inlets. Where the bounds cross,
+        the object corrects bound_hi for itself and leaves the array as it was.
+        """
+        if frames is None:
+            for a in (out, hz, symm):
+                if a is not None:
+                    frames = a.shape[1]
+                    break
+            for a in (bound_lo, bound_hi):
+                if frames is None and a is not None:
+                    frames = a.shape[0]
+        if frames is None:
+            raise ValueError("render needs frames or an array to size it from")
+        if out is None:
+            out = np.zeros((self.voices, frames))
+
+        ins = [None] * self._numins
+        if bound_lo is not None:
+            ins[0] = _vector_pointer(bound_lo, frames, "bound_lo")
+        if bound_hi is not None:
+            ins[1] = _vector_pointer(bound_hi, frames, "bound_hi")
+        if hz is not None:
+            ins[2:2 + self.voices] = _row_pointers(hz, self.voices, frames, "hz")
+        if symm is not None:
+            ins[2 + self.voices:] = _row_pointers(symm, self.voices, frames, "symm")
+        outs = _row_pointers(out, self.voices, frames, "out")
+
+        with _lock:
+            self._dsp(tuple(0 if p is None else 1 for p in ins))
+        _lib.bounce_host_render(self._h, (_DOUBLE_P * self._numins)(*ins),
+                                (_DOUBLE_P * self.voices)(*outs), frames)
+        return out
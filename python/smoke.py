@@ -0,0 +1,108 @@
+"""
+smoke.py
+Smoke test for the Python bindings: renders ensembles through dbbounce into
+NumPy arrays and checks them bit for bit against "bounce_bench render", the
+same setup driven from C through the host. Then checks render() writes into
+the caller's array in place, and that ensembles rendered in parallel threads
+match the same ensembles rendered one after another.
+
+    make -C host && python3 python/smoke.py
+
+DB_BOUNCE_BENCH overrides where bounce_bench is run from.
+"""
+
+import os
+import subprocess
+import sys
+import threading
+
+import numpy as np
+
+import dbbounce
+
+SR = 48000.0        # bounce_bench's BENCH_SR / BENCH_VECTOR
+VECTOR = 64
+FRAMES = 48000
+
+_bench = os.environ.get("DB_BOUNCE_BENCH") or os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "host", "bounce_bench")
+
+# creation args, then messages and inlet:value floats in the order they are applied
+CASES = [
+    ("1 -1. 1. 0", ["2:110", "shape 1 0.6"]),
+    ("3 -1. 1. 1", ["2:110", "3:165.5", "4:220", "5:0.3", "fm 1 2 0.5", "fm 2 3 0.3", "fm 3 1 0.2"]),
+    ("4 -0.5 0.8 0 3", ["2:60", "3:87", "4:126", "5:183", "fm 1 2 0.15", "fm 2 1 -0.15",
+                        "fmrate 16", "fminterp 0", "dc 1 0 1 0", "voices 4"]),
+    ("2 -1. 1. 0", ["2:0.7", "3:1.9", "fm 1 2 0.4", "lfo 1"]),
+]
+
+
+def fail(what):
+    print("smoke: FAIL - " + what)
+    sys.exit(1)
+
+
+def make(args, steps):
+    a = args.split()
+    b = dbbounce.Bounce(voices=int(a[0]), bound_lo=float(a[1]), bound_hi=float(a[2]),
+                        mode=int(a[3]), active=int(a[4]) if len(a) > 4 else None,
+                        samplerate=SR, vectorsize=VECTOR)
+    for s in steps:
+        inlet, colon, value = s.partition(":")
+        if colon and inlet.isdigit():
+            b._float(int(inlet), float(value))
+        else:
+            b.send(s)
+    return b
+
+
+def reference(args, steps):
+    raw = subprocess.check_output([_bench, "render", str(FRAMES), args] + steps)
+    return np.frombuffer(raw, dtype=np.float64).reshape(FRAMES, -1).T
+
+
+def main():
+    if not os.path.exists(_bench):
+        fail("%s not found - run make -C host first" % _bench)
+
+    # same output as the C host, bit for bit
+    for args, steps in CASES:
+        out = make(args, steps).render(FRAMES)
+        ref = reference(args, steps)
+        if out.shape != ref.shape:
+            fail("%s: shape %s, bounce_bench gave %s" % (args, out.shape, ref.shape))
+        if not np.array_equal(out, ref):
+            n = np.argwhere(out != ref)[0]
+            fail("%s: differs from bounce_bench at voice %d frame %d" % (args, n[0] + 1, n[1]))
+        if not np.all(np.isfinite(out)) or not np.any(out):
+            fail("%s: output is silent or not finite" % args)
+
+    # written in place: into the array given, and into column slices of it
+    args, steps = CASES[1]
+    whole = make(args, steps).render(FRAMES)
+    buf = np.full((3, FRAMES), np.nan)
+    b = make(args, steps)
+    for part in (buf[:, :FRAMES // 3], buf[:, FRAMES // 3:]):
+        if b.render(out=part) is not part:
+            fail("render(out=...) returned a different array")
+    if not np.array_equal(buf, whole):
+        fail("rendering into slices of out differs from one render")
+
+    # threads: parallel renders match serial ones
+    serial = [make(a, s).render(FRAMES) for a, s in CASES]
+    objs = [make(a, s) for a, s in CASES]
+    outs = [np.zeros((o.voices, FRAMES)) for o in objs]
+    threads = [threading.Thread(target=o.render, kwargs={"out": out}) for o, out in zip(objs, outs)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for (args, _), a, b in zip(CASES, serial, outs):
+        if not np.array_equal(a, b):
+            fail("%s: rendered in a thread differs from serial" % args)
+
+    print("smoke: ok - %d ensembles match bounce_bench, in place and threaded renders match" % len(CASES))
+
+
+if __name__ == "__main__":
+    main()